@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+
+namespace tiles {
+
+struct render_cancelled : public std::exception {
+  char const* what() const noexcept override { return "render cancelled"; }
+};
+
+// Cooperative cancellation of a tile render: checked between packs and
+// every few features, rendering stops with render_cancelled.
+//
+// Cancelled explicitly, after the deadline, or while everyone who was
+// interested in the result is gone (a render may be shared by several
+// requests: each one adds interest and drops it on disconnect). Unlike the
+// other two, a lack of interest is not sticky: a request joining a render
+// whose previous requests have all left picks it up again.
+struct cancel_token {
+  using clock_t = std::chrono::steady_clock;
+
+  void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+
+  void add_interest() {
+    interest_.fetch_add(1, std::memory_order_relaxed);
+    interested_.store(true, std::memory_order_relaxed);
+  }
+  void drop_interest() { interest_.fetch_sub(1, std::memory_order_relaxed); }
+
+  bool is_abandoned() const {
+    return interested_.load(std::memory_order_relaxed) &&
+           interest_.load(std::memory_order_relaxed) == 0;
+  }
+
+  bool is_cancelled() const {
+    return cancelled_.load(std::memory_order_relaxed) || is_abandoned() ||
+           (deadline_ != clock_t::time_point::max() &&
+            clock_t::now() >= deadline_);
+  }
+
+  void throw_if_cancelled() const {
+    if (is_cancelled()) {
+      throw render_cancelled{};
+    }
+  }
+
+  std::atomic_bool cancelled_{false};
+  std::atomic_size_t interest_{0};
+  std::atomic_bool interested_{false};  // interest_ == 0 only counts if set
+
+  // only to be set before the render starts
+  clock_t::time_point deadline_{clock_t::time_point::max()};
+};
+
+inline cancel_token const& never_cancelled() {
+  static cancel_token const token;
+  return token;
+}
+
+}  // namespace tiles
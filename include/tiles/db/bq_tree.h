@@ -16,6 +16,9 @@ struct bq_tree {
   explicit bq_tree(std::vector<bq_node_t> nodes) : nodes_{std::move(nodes)} {}
 
   bool contains(geo::tile const& q) const;
+
+  // q is inside a TRUE leaf or a TRUE leaf is inside q
+  bool intersects(geo::tile const& q) const;
   std::vector<geo::tile> all_leafs(geo::tile const& q) const;
 
   std::string_view string_view() const;
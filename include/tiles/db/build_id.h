@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <random>
+#include <string>
+
+#include "fmt/core.h"
+
+#include "tiles/db/tile_database.h"
+
+namespace tiles {
+
+// Identifies one state of the database contents: every import which changes
+// features or tiles stores a new one. Clients use it (e.g. as part of ETags)
+// to detect that previously served tiles are outdated.
+inline std::string make_build_id() {
+  std::random_device rd;
+  auto const now = std::chrono::system_clock::now().time_since_epoch().count();
+  return fmt::format("{:016x}{:08x}", static_cast<uint64_t>(now), rd());
+}
+
+inline void store_build_id(tile_db_handle& handle, lmdb::txn& txn,
+                           std::string const& build_id) {
+  auto meta_dbi = handle.meta_dbi(txn);
+  txn.put(meta_dbi, kMetaKeyBuildId, build_id);
+}
+
+inline std::optional<std::string> get_build_id(tile_db_handle& handle,
+                                               lmdb::txn& txn) {
+  auto meta_dbi = handle.meta_dbi(txn);
+  auto const opt_build_id = txn.get(meta_dbi, kMetaKeyBuildId);
+  if (!opt_build_id) {
+    return std::nullopt;
+  }
+  return std::string{*opt_build_id};
+}
+
+}  // namespace tiles
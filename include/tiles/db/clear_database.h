@@ -13,6 +13,9 @@ inline void clear_database(tile_db_handle& handle, lmdb::txn& txn) {
 
   auto tiles_dbi = handle.tiles_dbi(txn, lmdb::dbi_flags::CREATE);
   txn.dbi_clear(tiles_dbi);
+
+  // new databases always use the current layout
+  handle.set_feature_key_layout(txn, kDefaultFeatureKeyLayout);
 }
 
 inline void clear_database(std::string const& db_fname, size_t const db_size) {
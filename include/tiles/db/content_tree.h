@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#include "geo/tile.h"
+#include "lmdb/lmdb.hpp"
+
+#include "tiles/db/bq_tree.h"
+#include "tiles/db/tile_database.h"
+#include "tiles/db/tile_index.h"
+
+namespace tiles {
+
+// Tiles (on the index zoom level) which have at least one pack record in
+// the features dbi. Any tile which does not intersect this tree (nor the
+// fully seaside tree) is empty: no need to look at the feature index.
+inline bq_tree make_content_tree(tile_db_handle& handle, lmdb::txn& txn) {
+  auto features_dbi = handle.features_dbi(txn);
+  auto c = lmdb::cursor{txn, features_dbi};
+
+  std::vector<geo::tile> tiles;
+  for (auto el = c.get<tile_key_t>(lmdb::cursor_op::FIRST); el;
+       el = c.get<tile_key_t>(lmdb::cursor_op::NEXT)) {
+    auto const tile = key_to_tile(handle.feature_key_layout_, el->first);
+    if (tiles.empty() || !(tiles.back() == tile)) {
+      tiles.push_back(tile);
+    }
+  }
+  return make_bq_tree(tiles);
+}
+
+inline void store_content_tree(tile_db_handle& handle, lmdb::txn& txn) {
+  auto const tree = make_content_tree(handle, txn);
+  auto meta_dbi = handle.meta_dbi(txn);
+  txn.put(meta_dbi, kMetaKeyContentTree, tree.string_view());
+}
+
+}  // namespace tiles
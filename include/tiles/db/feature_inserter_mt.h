@@ -31,9 +31,11 @@ struct feature_inserter_mt {
   static constexpr size_t kCacheThresholdUpper = 1024ULL * 1024 * 1024;
   static constexpr size_t kCacheThresholdLower = kCacheThresholdUpper / 4 * 3;
 
-  feature_inserter_mt(dbi_handle dbi_handle, pack_handle& pack_handle)
+  feature_inserter_mt(dbi_handle dbi_handle, pack_handle& pack_handle,
+                      tile_key_layout const layout)
       : dbi_handle_{std::move(dbi_handle)},
         pack_handle_{pack_handle},
+        layout_{layout},
         cache_((1ULL << kTileDefaultIndexZoomLvl) *
                (1ULL << kTileDefaultIndexZoomLvl)) {
     auto it = geo::tile_iterator{kTileDefaultIndexZoomLvl};
@@ -135,7 +137,7 @@ struct feature_inserter_mt {
       lmdb::cursor c{txn_dbi.first, txn_dbi.second};
 
       for (auto const& [bucket_ptr, features] : queue) {
-        auto key = tile_to_key(bucket_ptr->tile_);
+        auto key = tile_to_key(layout_, bucket_ptr->tile_);
         auto pack_record = pack_handle_.append(pack_features(features));
 
         if (auto el = c.get(lmdb::cursor_op::SET_KEY, key); el) {
@@ -167,6 +169,7 @@ struct feature_inserter_mt {
 
   dbi_handle dbi_handle_;
   pack_handle& pack_handle_;
+  tile_key_layout layout_;
 
   std::mutex flush_mutex_;
   std::atomic_size_t cache_size_{0};
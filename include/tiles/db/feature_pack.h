@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <limits>
 #include <map>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -9,7 +13,7 @@
 #include "tiles/bin_utils.h"
 #include "tiles/db/quad_tree.h"
 
-// FEATURE PACK "WIRE FORMAT" SPECIFICATION v2.1
+// FEATURE PACK "WIRE FORMAT" SPECIFICATION v3
 //
 // A feature pack is intended to hold serialized feature data for features in
 // one "bucket" of the toplevel geo index.
@@ -22,6 +26,8 @@
 //
 // TYPE ID VALUES:
 //    0x0: quad tree index
+//    0x1: feature skip index (see below)
+//    0x2: feature columns (see below, v3 only)
 //
 //  The pack starts with the header at offset 0x0.
 //
@@ -50,10 +56,47 @@
 //
 // The last four bytes of the feature pack are a crc32 checksum of the entire
 // feature pack (obviously excluding the checksum itself).
+//
+// FEATURE SKIP INDEX LAYOUT (columns, each one entry per feature):
+//  4b     : uint32_t : entry count k
+//  k * 4b : uint32_t : feature offset (of the size prefix, ascending)
+//  k * 1b : uint8_t  : min zoom level
+//  k * 1b : uint8_t  : max zoom level
+//  k * 4b : uint32_t : bounding box min x
+//  k * 4b : uint32_t : bounding box min y
+//  k * 4b : uint32_t : bounding box max x
+//  k * 4b : uint32_t : bounding box max y
+//
+// The values are a conservative copy of the feature header (clamped to the
+// column type): a feature may only be skipped if it is rejected by them.
+// In v3 packs they are the feature header and therefore exact: a pack with
+// a feature that does not fit into the columns is written as v2 instead.
+//
+// V3 (COLUMNAR) PACKS:
+//  A pack with a feature columns segment is a v3 pack. Its features are
+//  split into columns: the header (zoom levels and bounding box) is the
+//  feature skip index (required), id, layer and metadata are stored in
+//  the feature columns segment. The feature strings hold only the
+//  remaining simplify masks and geometry. All parts are encoded as in v2.
+//
+// FEATURE COLUMNS LAYOUT (segment offset is 8 byte aligned):
+//  4b           : uint32_t : entry count k
+//  4b           : uint32_t : reserved (zero)
+//  k * 8b       : uint64_t : feature id
+//  k * 4b       : uint32_t : layer
+//  (k + 1) * 4b : uint32_t : metadata offsets (relative to metadata begin)
+//  var          : metadata, one message with pairs, keys and values each
 
 namespace tiles {
 
 constexpr auto const kQuadTreeFeatureIndexId = 0x0;
+constexpr auto const kFeatureSkipIndexId = 0x1;
+constexpr auto const kFeatureColumnsId = 0x2;
+
+enum class feature_pack_format : uint8_t {
+  v2,  // one string per feature
+  v3  // columnar
+};
 
 struct feature_packer {
   void register_segment(uint8_t const id) {
@@ -94,6 +137,12 @@ struct feature_packer {
 
   void append_feature(std::string const& feature) {
     utl::verify(feature.size() >= 32, "MINI FEATURE?!");
+    append_feature_string(feature);
+  }
+
+  // no plausibility check: v3 feature strings may be tiny (e.g. a point)
+  void append_feature_string(std::string_view const feature) {
+    utl::verify(!feature.empty(), "packer: empty feature string");
     protozero::write_varint(std::back_inserter(buf_), feature.size());
     buf_.append(feature.data(), feature.size());
   }
@@ -111,6 +160,22 @@ struct feature_packer {
     return offset;
   }
 
+  // see FEATURE SKIP INDEX LAYOUT, entries in feature order
+  struct skip_entry {
+    uint32_t offset_;
+    uint8_t min_z_, max_z_;
+    uint32_t min_x_, min_y_, max_x_, max_y_;
+  };
+  uint32_t append_skip_index(std::vector<skip_entry> const&);
+
+  // see FEATURE COLUMNS LAYOUT, entries in feature order
+  struct column_entry {
+    uint64_t id_;
+    uint32_t layer_;
+    std::string meta_;
+  };
+  uint32_t append_columns(std::vector<column_entry> const&);
+
   template <typename String>
   uint32_t append(String const& string) {
     auto const offset = static_cast<uint32_t>(buf_.size());
@@ -139,6 +204,157 @@ inline std::optional<uint32_t> find_segment_offset(std::string_view const pack,
   return offset;
 }
 
+// zoom level and (fixed coordinate) box of a render query, clamped like the
+// columns of the skip index
+struct feature_skip_query {
+  feature_skip_query(uint32_t const z, int64_t const min_x,
+                     int64_t const min_y, int64_t const max_x,
+                     int64_t const max_y)
+      : z_{clamp<uint8_t>(z)},
+        min_x_{clamp<uint32_t>(min_x)},
+        min_y_{clamp<uint32_t>(min_y)},
+        max_x_{clamp<uint32_t>(max_x)},
+        max_y_{clamp<uint32_t>(max_y)} {}
+
+  template <typename T, typename V>
+  static T clamp(V const v) {
+    return static_cast<T>(std::clamp(
+        static_cast<int64_t>(v), int64_t{0},
+        static_cast<int64_t>(std::numeric_limits<T>::max())));
+  }
+
+  uint8_t z_;
+  uint32_t min_x_, min_y_, max_x_, max_y_;
+};
+
+// read-only view of the feature skip index segment of a pack
+struct feature_skip_index {
+  static constexpr auto const kEntrySize = 4ULL + 2ULL + 4ULL * 4ULL;
+
+  static std::optional<feature_skip_index> find(std::string_view const pack) {
+    auto const offset = find_segment_offset(pack, kFeatureSkipIndexId);
+    if (!offset || pack.size() < *offset + sizeof(uint32_t)) {
+      return std::nullopt;
+    }
+
+    auto const count = read<uint32_t>(pack.data(), *offset);
+    utl::verify(pack.size() >= *offset + sizeof(uint32_t) + count * kEntrySize,
+                "invalid feature_pack skip index");
+    return feature_skip_index{pack.data() + *offset + sizeof(uint32_t),
+                              count};
+  }
+
+  // index of the feature with the given offset (size() if unknown)
+  uint32_t find_feature(uint32_t const feature_offset) const {
+    auto lo = uint32_t{0}, hi = count_;
+    while (lo < hi) {
+      auto const mid = lo + (hi - lo) / 2;
+      if (read_nth<uint32_t>(base_, mid) < feature_offset) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo != count_ && read_nth<uint32_t>(base_, lo) == feature_offset
+               ? lo
+               : count_;
+  }
+
+  // same checks as deserialize_feature, without touching the feature
+  bool may_match(uint32_t const i, feature_skip_query const& q) const {
+    if (i >= count_) {
+      return true;  // not indexed: cannot skip
+    }
+
+    auto const [min_z, max_z] = zoom_levels(i);
+    auto const [min_x, min_y, max_x, max_y] = box(i);
+    return min_z <= q.z_ && max_z >= q.z_ &&  //
+           max_x >= q.min_x_ && min_x <= q.max_x_ &&  //
+           max_y >= q.min_y_ && min_y <= q.max_y_;
+  }
+
+  std::pair<uint8_t, uint8_t> zoom_levels(uint32_t const i) const {
+    auto const* zoom = base_ + count_ * 4ULL;
+    return {read_nth<uint8_t>(zoom, i), read_nth<uint8_t>(zoom, count_ + i)};
+  }
+
+  // min x, min y, max x, max y
+  std::array<uint32_t, 4> box(uint32_t const i) const {
+    auto const* coords = base_ + count_ * 6ULL;
+    return {read_nth<uint32_t>(coords, i),
+            read_nth<uint32_t>(coords, count_ + i),
+            read_nth<uint32_t>(coords, 2ULL * count_ + i),
+            read_nth<uint32_t>(coords, 3ULL * count_ + i)};
+  }
+
+  uint32_t size() const { return count_; }
+
+  char const* base_;
+  uint32_t count_;
+};
+
+// read-only view of the feature columns segment of a v3 pack
+struct feature_columns {
+  static std::optional<feature_columns> find(std::string_view const pack) {
+    auto const offset = find_segment_offset(pack, kFeatureColumnsId);
+    if (!offset) {
+      return std::nullopt;
+    }
+
+    auto const skip_index = feature_skip_index::find(pack);
+    utl::verify(skip_index.has_value(), "v3 feature_pack without skip index");
+    utl::verify(pack.size() >= *offset + 8ULL, "invalid feature_pack columns");
+    auto const count = read<uint32_t>(pack.data(), *offset);
+    utl::verify(count == skip_index->size() &&
+                    pack.size() >= *offset + 8ULL + count * 16ULL + 4ULL,
+                "invalid feature_pack columns");
+
+    feature_columns columns{*skip_index, pack.data() + *offset + 8ULL,
+                            count};
+    utl::verify(columns.meta_begin() + read_nth<uint32_t>(
+                                           columns.meta_offsets(), count) <=
+                    pack.data() + pack.size(),
+                "invalid feature_pack columns metadata");
+    return columns;
+  }
+
+  uint64_t id(uint32_t const i) const { return read_nth<uint64_t>(base_, i); }
+
+  uint32_t layer(uint32_t const i) const {
+    return read_nth<uint32_t>(base_ + count_ * 8ULL, i);
+  }
+
+  std::string_view meta(uint32_t const i) const {
+    auto const begin = read_nth<uint32_t>(meta_offsets(), i);
+    auto const end = read_nth<uint32_t>(meta_offsets(), i + 1);
+    return {meta_begin() + begin, end - begin};
+  }
+
+  uint32_t size() const { return count_; }
+
+  // size of the segment (without alignment padding)
+  size_t byte_size() const {
+    return static_cast<size_t>(
+        meta_begin() + read_nth<uint32_t>(meta_offsets(), count_) -
+        (base_ - 8ULL));
+  }
+
+  char const* meta_offsets() const { return base_ + count_ * 12ULL; }
+  char const* meta_begin() const { return base_ + count_ * 16ULL + 4ULL; }
+
+  feature_skip_index skip_index_;  // header columns
+  char const* base_;
+  uint32_t count_;
+};
+
+// one feature of a v3 pack (see deserialize_feature)
+struct columnar_feature {
+  feature_columns const* columns_;
+  uint32_t idx_;
+  std::string_view geometry_;  // the feature string: masks and geometry
+};
+
+// raw feature strings in pack order (v3: only masks and geometry)
 template <typename Fn>
 size_t unpack_features(std::string_view const& string, Fn&& fn) {
   utl::verify(string.size() >= 5, "unpack_features: invalid feature_pack");
@@ -158,9 +374,15 @@ size_t unpack_features(std::string_view const& string, Fn&& fn) {
   return static_cast<size_t>(std::distance(string.data(), ptr));
 }
 
+// features below tile; with a query, features rejected by the skip index
+// (if the pack has one) are not passed to fn
+//
+// fn is called with a std::string_view (v2) or a columnar_feature (v3)
 template <typename Fn>
 void unpack_features(geo::tile const& root, std::string_view const& string,
-                     geo::tile const& tile, Fn&& fn) {
+                     geo::tile const& tile,
+                     std::optional<feature_skip_query> const& query,
+                     Fn&& fn) {
   utl::verify(string.size() >= 5, "unpack_features: invalid feature_pack");
   auto const idx_offset = find_segment_offset(string, kQuadTreeFeatureIndexId);
   if (!idx_offset) {
@@ -169,6 +391,11 @@ void unpack_features(geo::tile const& root, std::string_view const& string,
   }
 
   utl::verify(string.size() >= *idx_offset, "invalid feature_pack idx_offset");
+  auto const columns = feature_columns::find(string);
+  auto const skip_idx = columns ? std::make_optional(columns->skip_index_)
+                        : query ? feature_skip_index::find(string)
+                                : std::nullopt;
+
   auto const* idx_ptr = string.data() + *idx_offset;
   auto const* const end = string.data() + string.size();
   for (auto z = root.z_; z <= std::max(root.z_, tile.z_); ++z) {
@@ -181,17 +408,36 @@ void unpack_features(geo::tile const& root, std::string_view const& string,
         string.data() + tree_offset, root, tile,
         [&](auto const span_offset, auto const span_count) {
           auto span_ptr = string.data() + span_offset;
+          auto feature_idx =
+              skip_idx ? skip_idx->find_feature(span_offset) : 0U;
           for (auto i = 0ULL; i < span_count; ++i) {
             size_t size = 0;
             while ((size = protozero::decode_varint(&span_ptr, end)) != 0) {
-              fn(std::string_view{span_ptr, size});
+              auto const feature_str = std::string_view{span_ptr, size};
+              if (columns) {
+                utl::verify(feature_idx < columns->size(),
+                            "v3 feature_pack: feature not indexed");
+                if (!query || skip_idx->may_match(feature_idx, *query)) {
+                  fn(columnar_feature{&*columns, feature_idx, feature_str});
+                }
+              } else if (!query || !skip_idx ||
+                         skip_idx->may_match(feature_idx, *query)) {
+                fn(feature_str);
+              }
               span_ptr += size;
+              ++feature_idx;
             }
           }
         });
   }
 }
 
+template <typename Fn>
+void unpack_features(geo::tile const& root, std::string_view const& string,
+                     geo::tile const& tile, Fn&& fn) {
+  unpack_features(root, string, tile, std::nullopt, std::forward<Fn>(fn));
+}
+
 struct tile_db_handle;
 struct pack_handle;
 struct shared_metadata_coder;
@@ -201,10 +447,12 @@ std::string pack_features(std::vector<std::string> const&);
 
 // optimal packing (incl. index)
 std::string pack_features(geo::tile const&, shared_metadata_coder const&,
-                          std::vector<std::string> const&);
+                          std::vector<std::string> const&,
+                          feature_pack_format = feature_pack_format::v2);
 
 // full database packing (e.g. once and optimal)
-void pack_features(tile_db_handle&, pack_handle&);
+void pack_features(tile_db_handle&, pack_handle&,
+                   feature_pack_format = feature_pack_format::v2);
 
 // full database packing (with custom packing function)
 void pack_features(
@@ -31,6 +31,7 @@ struct quadtree_feature_packer {
                           shared_metadata_coder const& metadata_coder)
       : root_{root}, metadata_coder_{metadata_coder} {
     packer_.register_segment(kQuadTreeFeatureIndexId);
+    packer_.register_segment(kFeatureSkipIndexId);
   }
 
   virtual ~quadtree_feature_packer() = default;
@@ -49,12 +50,32 @@ struct quadtree_feature_packer {
   virtual uint32_t serialize_and_append_span(quadtree_feature_it,
                                              quadtree_feature_it);
 
-  void finish();
+  void add_skip_entry(uint32_t offset, feature const&);
+
+  virtual void finish();
 
   geo::tile root_;
   shared_metadata_coder const& metadata_coder_;
 
   feature_packer packer_;
+  std::vector<feature_packer::skip_entry> skip_entries_;
+  bool exact_skip_entries_{true};  // nothing clamped (v3 requirement)
+};
+
+// v3 (columnar) packs, see feature_pack.h
+struct columnar_feature_packer : public quadtree_feature_packer {
+  columnar_feature_packer(geo::tile root,
+                          shared_metadata_coder const& metadata_coder)
+      : quadtree_feature_packer{root, metadata_coder} {
+    packer_.register_segment(kFeatureColumnsId);
+  }
+
+  uint32_t serialize_and_append_span(quadtree_feature_it,
+                                     quadtree_feature_it) override;
+
+  void finish() override;
+
+  std::vector<feature_packer::column_entry> column_entries_;
 };
 
 }  // namespace tiles
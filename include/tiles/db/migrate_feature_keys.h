@@ -0,0 +1,131 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fmt/core.h"
+
+#include "lmdb/lmdb.hpp"
+
+#include "utl/verify.h"
+
+#include "tiles/db/tile_database.h"
+#include "tiles/db/tile_index.h"
+#include "tiles/util.h"
+
+namespace tiles {
+
+constexpr auto kMigrateFeatureKeysBatchSize = size_t{100'000};
+
+// Rewrites all keys of the features dbi to another layout. Entries are
+// copied in batches (one write transaction each, never the whole dbi in
+// memory):
+//  1. all entries with their new keys into a temporary dbi
+//  2. clear the features dbi and copy them back (marked in meta)
+//  3. store the new layout in meta (last: until then, the features dbi is
+//     read with the old layout)
+// An interrupted migration restarts in step 1 or resumes step 2 (copying
+// an entry twice is harmless). The tiles dbi (prepared tiles) is not
+// affected.
+inline void migrate_feature_keys(
+    tile_db_handle& handle, tile_key_layout const target,
+    size_t const batch_size = kMigrateFeatureKeysBatchSize) {
+  auto const source = handle.feature_key_layout_;
+  if (source == target) {
+    t_log("migrate_feature_keys: nothing to do");
+    return;
+  }
+
+  auto const target_version = target == tile_key_layout::morton ? "1" : "0";
+  auto const tmp_name = fmt::format("{}-migrate", handle.dbi_name_features_);
+  auto const features_dbi = [&](lmdb::txn& txn) {
+    return handle.features_dbi(txn);
+  };
+  auto const tmp_dbi = [&](lmdb::txn& txn) {
+    return txn.dbi_open(tmp_name.c_str(), lmdb::dbi_flags::CREATE |
+                                              lmdb::dbi_flags::INTEGERKEY);
+  };
+
+  auto const copy = [&](auto&& from_dbi, auto&& to_dbi, auto&& to_key) {
+    auto count = size_t{0};
+    auto last = std::optional<tile_key_t>{};
+    while (true) {
+      auto txn = handle.make_txn();
+      auto from = from_dbi(txn);
+      auto to = to_dbi(txn);
+
+      std::vector<std::pair<tile_key_t, std::string>> batch;
+      {
+        auto c = lmdb::cursor{txn, from};
+        auto el = last ? c.get(lmdb::cursor_op::SET_RANGE, *last)
+                       : c.get<tile_key_t>(lmdb::cursor_op::FIRST);
+        if (el && last && el->first == *last) {
+          el = c.get<tile_key_t>(lmdb::cursor_op::NEXT);
+        }
+        for (; el && batch.size() < batch_size;
+             el = c.get<tile_key_t>(lmdb::cursor_op::NEXT)) {
+          batch.emplace_back(el->first, std::string{el->second});
+        }
+      }
+
+      for (auto const& [key, value] : batch) {
+        txn.put(to, to_key(key), value);
+      }
+      txn.commit();
+
+      count += batch.size();
+      if (batch.size() < batch_size) {
+        return count;
+      }
+      last = batch.back().first;
+    }
+  };
+
+  auto const resume = [&] {
+    auto txn = handle.make_txn();
+    auto meta_dbi = handle.meta_dbi(txn);
+    auto const marker = txn.get(meta_dbi, kMetaKeyFeatureKeyMigration);
+    if (marker) {
+      utl::verify(*marker == target_version,
+                  "migrate_feature_keys: other migration pending [target={}]",
+                  *marker);
+    }
+    return marker.has_value();
+  }();
+
+  if (!resume) {
+    {
+      auto txn = handle.make_txn();
+      txn.dbi_clear(tmp_dbi(txn));  // leftovers of an interrupted step 1
+      txn.commit();
+    }
+
+    copy(features_dbi, tmp_dbi, [&](tile_key_t const key) {
+      return tile_to_key(target, key_to_tile(source, key), key_to_n(key));
+    });
+
+    auto txn = handle.make_txn();
+    auto meta_dbi = handle.meta_dbi(txn);
+    txn.dbi_clear(features_dbi(txn));
+    txn.put(meta_dbi, kMetaKeyFeatureKeyMigration, target_version);
+    txn.commit();
+  } else {
+    t_log("migrate_feature_keys: resume interrupted migration");
+  }
+
+  auto const count =
+      copy(tmp_dbi, features_dbi, [](tile_key_t const key) { return key; });
+
+  auto txn = handle.make_txn();
+  auto meta_dbi = handle.meta_dbi(txn);
+  txn.dbi_remove(tmp_dbi(txn));
+  txn.del(meta_dbi, kMetaKeyFeatureKeyMigration);
+  handle.set_feature_key_layout(txn, target);
+  txn.commit();
+
+  t_log("migrate_feature_keys: {} entries migrated", count);
+}
+
+}  // namespace tiles
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "lmdb/lmdb.hpp"
+
+#include "tiles/db/tile_database.h"
+
+namespace tiles {
+
+// Read-only transaction plus a cursor on the features dbi. It is reset
+// (mdb_txn_reset) after use and renewed (mdb_txn_renew) for the next use.
+// The reader slot and the cursor are kept in between.
+struct read_txn {
+  explicit read_txn(tile_db_handle&);
+
+  void renew();
+  void reset();
+
+  lmdb::txn txn_;
+  lmdb::cursor features_cursor_;
+};
+
+// Free list of read_txns. Acquired transactions are renewed. They go
+// back to the pool when the last reference is dropped.
+//
+// At most max_size transactions exist (each one holds a reader slot, even
+// while it is reset): acquire blocks while all of them are in use,
+// try_acquire gives up instead. try_acquire leaves keep_free of them for
+// others, e.g. for render threads while responses hold transactions for
+// as long as a (slow) client takes to read them.
+//
+// The environment must be opened with NOTLS: a transaction may be
+// released on another thread (e.g. by a zero-copy response) and is then
+// used by that thread next.
+struct read_txn_pool {
+  read_txn_pool(tile_db_handle& handle, size_t const max_size)
+      : handle_{handle}, max_size_{max_size} {}
+
+  read_txn_pool(read_txn_pool const&) = delete;
+  read_txn_pool(read_txn_pool&&) = delete;
+  read_txn_pool& operator=(read_txn_pool const&) = delete;
+  read_txn_pool& operator=(read_txn_pool&&) = delete;
+
+  ~read_txn_pool() = default;
+
+  std::shared_ptr<read_txn> acquire();
+  std::shared_ptr<read_txn> try_acquire(size_t keep_free = 0);
+
+  size_t in_use() const;
+
+private:
+  std::shared_ptr<read_txn> take(std::unique_lock<std::mutex>&);
+
+  tile_db_handle& handle_;
+  size_t max_size_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable released_;
+  size_t in_use_{0};
+  std::vector<std::unique_ptr<read_txn>> free_;
+};
+
+}  // namespace tiles
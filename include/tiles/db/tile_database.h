@@ -1,10 +1,12 @@
 #pragma once
 
 #include <map>
+#include <optional>
 
 #include "geo/tile.h"
 #include "lmdb/lmdb.hpp"
 
+#include "tiles/db/tile_index.h"
 #include "tiles/util.h"
 
 namespace tiles {
@@ -12,24 +14,36 @@ namespace tiles {
 constexpr auto kDefaultSize =
     sizeof(void*) >= 8 ? 1024ULL * 1024 * 1024 * 1024 : 256 * 1024 * 1024;
 
+constexpr auto kDefaultMaxReaders = 126U;  // lmdb default
+
 constexpr auto kDefaultMeta = "default_meta";
 constexpr auto kDefaultFeatures = "default_features";
 constexpr auto kDefaultTiles = "default_tiles";
 
 constexpr auto kMetaKeyMaxPreparedZoomLevel = "max-prepared-zoomlevel";
 constexpr auto kMetaKeyFullySeasideTree = "fully-seaside-tree";
+constexpr auto kMetaKeyContentTree = "content-tree";
 constexpr auto kMetaKeyLayerNames = "layer-names";
 constexpr auto kMetaKeyFeatureMetaCoding = "feature-meta-coding";
+constexpr auto kMetaKeyBuildId = "build-id";
+constexpr auto kMetaKeyFeatureKeyLayout = "feature-key-layout";
+constexpr auto kMetaKeyFeatureKeyMigration = "feature-key-migration";
+
+// key layout of the features dbi, stored as a format version:
+// "0" (or missing: older databases) row major, "1" morton
+constexpr auto kDefaultFeatureKeyLayout = tile_key_layout::morton;
 
 using dbi_opener_fn =
     std::function<lmdb::txn::dbi(lmdb::txn&, lmdb::dbi_flags)>;
 
 inline lmdb::env make_tile_database(
     char const* db_fname, size_t const db_size,
-    lmdb::env_open_flags flags = lmdb::env_open_flags::NOSUBDIR) {
+    lmdb::env_open_flags flags = lmdb::env_open_flags::NOSUBDIR,
+    unsigned const max_readers = kDefaultMaxReaders) {
   lmdb::env e;
   e.set_mapsize(db_size);
   e.set_maxdbs(8);
+  e.set_maxreaders(max_readers);
   try {
     e.open(db_fname, flags);
   } catch (...) {
@@ -39,6 +53,8 @@ inline lmdb::env make_tile_database(
   return e;
 }
 
+// In a read-only environment no dbi is created. The dbis are opened once
+// and the handles are reused by all later transactions.
 struct tile_db_handle {
   explicit tile_db_handle(lmdb::env& env,
                           char const* dbi_name_meta = kDefaultMeta,
@@ -49,37 +65,68 @@ struct tile_db_handle {
         dbi_name_features_{dbi_name_features},
         dbi_name_tiles_{dbi_name_tiles} {
     auto txn = make_txn();
-    meta_dbi(txn, lmdb::dbi_flags::CREATE);
-    features_dbi(txn, lmdb::dbi_flags::CREATE);
-    tiles_dbi(txn, lmdb::dbi_flags::CREATE);
+    if (is_read_only()) {
+      // dbis opened in a read-only txn are available after its commit
+      dbis_ = {meta_dbi(txn), features_dbi(txn), tiles_dbi(txn)};
+    } else {
+      meta_dbi(txn, lmdb::dbi_flags::CREATE);
+      features_dbi(txn, lmdb::dbi_flags::CREATE);
+      tiles_dbi(txn, lmdb::dbi_flags::CREATE);
+    }
+    feature_key_layout_ = read_feature_key_layout(txn);
     txn.commit();
   }
 
-  lmdb::txn make_txn() {
-    auto env_flags = env_.get_flags();
-
-    auto txn_flags = lmdb::txn_flags::NONE;
-    if ((env_flags & lmdb::env_open_flags::RDONLY) !=
-        lmdb::env_open_flags::NONE) {
-      txn_flags = lmdb::txn_flags::RDONLY;
+  tile_key_layout read_feature_key_layout(lmdb::txn& txn) const {
+    auto meta = meta_dbi(txn);
+    auto const version = txn.get(meta, kMetaKeyFeatureKeyLayout);
+    if (!version || *version == "0") {
+      return tile_key_layout::row_major;
     }
+    utl::verify(*version == "1", "unknown feature key layout {}", *version);
+    return tile_key_layout::morton;
+  }
+
+  // does not touch the keys (see migrate_feature_keys)
+  void set_feature_key_layout(lmdb::txn& txn, tile_key_layout const layout) {
+    auto meta = meta_dbi(txn);
+    txn.put(meta, kMetaKeyFeatureKeyLayout,
+            layout == tile_key_layout::morton ? "1" : "0");
+    feature_key_layout_ = layout;
+  }
 
-    return lmdb::txn{env_, txn_flags};
+  bool is_read_only() const {
+    return (env_.get_flags() & lmdb::env_open_flags::RDONLY) !=
+           lmdb::env_open_flags::NONE;
+  }
+
+  lmdb::txn make_txn() {
+    return lmdb::txn{env_, is_read_only() ? lmdb::txn_flags::RDONLY
+                                          : lmdb::txn_flags::NONE};
   }
 
   lmdb::txn::dbi meta_dbi(lmdb::txn& txn,
                           lmdb::dbi_flags flags = lmdb::dbi_flags::NONE) const {
+    if (dbis_.has_value() && flags == lmdb::dbi_flags::NONE) {
+      return dbis_->meta_;
+    }
     return txn.dbi_open(dbi_name_meta_, flags);
   }
 
   lmdb::txn::dbi features_dbi(
       lmdb::txn& txn, lmdb::dbi_flags flags = lmdb::dbi_flags::NONE) const {
+    if (dbis_.has_value() && flags == lmdb::dbi_flags::NONE) {
+      return dbis_->features_;
+    }
     return txn.dbi_open(dbi_name_features_,
                         flags | lmdb::dbi_flags::INTEGERKEY);
   }
 
   lmdb::txn::dbi tiles_dbi(
       lmdb::txn& txn, lmdb::dbi_flags flags = lmdb::dbi_flags::NONE) const {
+    if (dbis_.has_value() && flags == lmdb::dbi_flags::NONE) {
+      return dbis_->tiles_;
+    }
     return txn.dbi_open(dbi_name_tiles_, flags | lmdb::dbi_flags::INTEGERKEY);
   }
 
@@ -105,6 +152,13 @@ struct tile_db_handle {
   char const* dbi_name_meta_;
   char const* dbi_name_features_;
   char const* dbi_name_tiles_;
+
+  struct cached_dbis {
+    lmdb::txn::dbi meta_, features_, tiles_;
+  };
+  std::optional<cached_dbis> dbis_;
+
+  tile_key_layout feature_key_layout_{tile_key_layout::row_major};
 };
 
 struct dbi_handle {
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <utility>
+
 #include "geo/tile.h"
 
 #include "utl/verify.h"
@@ -59,7 +61,83 @@ inline tile_key_t key_to_n(tile_key_t const key) {
   return (key >> kTileKeyNShift) & kTileKeyNMask;
 }
 
+// Alternative layout (features dbi): z-order instead of rows
+//  5 bit | z | zoom level                    [0 - 32)
+// 42 bit | m | interleaved bits of y and x   (y in the odd bits)
+// 17 bit | n | n-th entry of tile            [0 - 131072)
+//
+// All descendants of a tile on a deeper zoom level have consecutive keys.
+enum class tile_key_layout : uint8_t { row_major, morton };
+
+constexpr tile_key_t kTileKeyMortonShift{17ULL};
+constexpr tile_key_t kTileKeyMortonBits{42ULL};
+
+inline uint64_t morton_spread(uint64_t v) {  // 21 bit -> even bits
+  v &= 0x1FFFFFULL;
+  v = (v | (v << 16U)) & 0x0000FFFF0000FFFFULL;
+  v = (v | (v << 8U)) & 0x00FF00FF00FF00FFULL;
+  v = (v | (v << 4U)) & 0x0F0F0F0F0F0F0F0FULL;
+  v = (v | (v << 2U)) & 0x3333333333333333ULL;
+  v = (v | (v << 1U)) & 0x5555555555555555ULL;
+  return v;
+}
+
+inline uint64_t morton_compact(uint64_t v) {  // even bits -> 21 bit
+  v &= 0x5555555555555555ULL;
+  v = (v | (v >> 1U)) & 0x3333333333333333ULL;
+  v = (v | (v >> 2U)) & 0x0F0F0F0F0F0F0F0FULL;
+  v = (v | (v >> 4U)) & 0x00FF00FF00FF00FFULL;
+  v = (v | (v >> 8U)) & 0x0000FFFF0000FFFFULL;
+  v = (v | (v >> 16U)) & 0x00000000FFFFFFFFULL;
+  return v & 0x1FFFFFULL;
+}
+
+inline tile_key_t tile_to_key(tile_key_layout const layout,
+                              geo::tile const t, tile_key_t const n = 0) {
+  if (layout == tile_key_layout::row_major) {
+    return tile_to_key(t, n);
+  }
+
+  utl::verify((t.x_ & kTileKeyXMask) == t.x_ &&
+                  (t.y_ & kTileKeyYMask) == t.y_ &&
+                  (t.z_ & kTileKeyZMask) == t.z_ && (n & kTileKeyNMask) == n,
+              "tile_to_key: value(s) in invalid range(s)");
+
+  tile_key_t key{0};
+  key |= (tile_key_t{t.z_} & kTileKeyZMask) << kTileKeyZShift;
+  key |= (morton_spread(t.x_) | (morton_spread(t.y_) << 1U))
+         << kTileKeyMortonShift;
+  key |= (n & kTileKeyNMask) << kTileKeyNShift;
+  return key;
+}
+
+inline geo::tile key_to_tile(tile_key_layout const layout,
+                             tile_key_t const key) {
+  if (layout == tile_key_layout::row_major) {
+    return key_to_tile(key);
+  }
+
+  auto const m = key >> kTileKeyMortonShift;
+  return geo::tile{
+      static_cast<uint32_t>(morton_compact(m)),
+      static_cast<uint32_t>(morton_compact(m >> 1U)),
+      static_cast<uint32_t>((key >> kTileKeyZShift) & kTileKeyZMask)};
+}
+
 constexpr auto const kTileDefaultIndexZoomLvl = 10;
+
+// [begin, end) of all morton keys on zoom level z inside of tile
+// (tile itself or its ancestor on z if tile.z_ > z)
+inline std::pair<tile_key_t, tile_key_t> morton_key_range(
+    geo::tile const& tile, uint32_t const z) {
+  auto const bounds = tile.bounds_on_z(z);
+  auto const corner = geo::tile{bounds.minx_, bounds.miny_, z};
+  auto const count = static_cast<tile_key_t>(bounds.maxx_ - bounds.minx_) *
+                     (bounds.maxy_ - bounds.miny_);
+
+  auto const begin = tile_to_key(tile_key_layout::morton, corner);
+  return {begin, begin + (count << kTileKeyMortonShift)};
+}
 inline geo::tile_range make_tile_range(fixed_box /*copy*/ box,
                                        uint32_t z = kTileDefaultIndexZoomLvl) {
   shift(box, z);
@@ -4,6 +4,7 @@
 
 #include "protozero/pbf_message.hpp"
 
+#include "tiles/db/feature_pack.h"
 #include "tiles/db/shared_metadata.h"
 #include "tiles/feature/feature.h"
 #include "tiles/fixed/algo/delta.h"
@@ -12,12 +13,72 @@
 
 namespace tiles {
 
+// pairs, keys and values fields (in this order)
+inline void read_metadata_field(
+    protozero::pbf_message<tags::feature>& msg,
+    shared_metadata_decoder const& metadata_decoder,
+    std::vector<metadata>& meta, size_t& meta_fill) {
+  switch (msg.tag()) {
+    case tags::feature::packed_uint64_meta_pairs:
+      utl::verify(meta.empty(),
+                  "meta_pairs must come before, meta keys/values!");
+      for (auto const packed_id : msg.get_packed_uint64()) {
+        meta.push_back(metadata_decoder.decode(packed_id));
+      }
+      meta_fill = meta.size();
+      break;
+
+    case tags::feature::repeated_string_keys:
+      meta.emplace_back(msg.get_string(), std::string{});
+      break;
+
+    case tags::feature::repeated_string_values:
+      utl::verify(meta_fill < meta.size(), "meta data imbalance! (a)");
+      meta[meta_fill++].value_ = msg.get_string();
+      break;
+
+    default: msg.skip();
+  }
+}
+
+// simplify masks and geometry fields (in this order)
+// returns false if the geometry is killed by the masks on this zoom level
+inline bool read_geometry_field(protozero::pbf_message<tags::feature>& msg,
+                                uint32_t const zoom_level_hint,
+                                std::vector<std::string_view>& simplify_masks,
+                                fixed_geometry& geometry) {
+  switch (msg.tag()) {
+    case tags::feature::repeated_string_simplify_masks:
+      simplify_masks.emplace_back(msg.get_view());
+      break;
+
+    case tags::feature::required_fixed_geometry_geometry: {
+      std::vector<std::string_view> simplify_masks_tmp;
+      std::swap(simplify_masks, simplify_masks_tmp);
+      if (zoom_level_hint != kInvalidZoomLevel &&
+          !simplify_masks_tmp.empty()) {
+        geometry = deserialize(msg.get_view(), std::move(simplify_masks_tmp),
+                               zoom_level_hint);
+        if (mpark::holds_alternative<fixed_null>(geometry)) {
+          return false;  // killed by mask
+        }
+      } else {
+        geometry = deserialize(msg.get_view());
+      }
+    } break;
+
+    default: msg.skip();
+  }
+  return true;
+}
+
 inline std::optional<feature> deserialize_feature(
     std::string_view const& str,  //
     shared_metadata_decoder const& metadata_decoder,
     fixed_box const& box_hint = {{kInvalidBoxHint, kInvalidBoxHint},
                                  {kInvalidBoxHint, kInvalidBoxHint}},
-    uint32_t const zoom_level_hint = kInvalidZoomLevel) {
+    uint32_t const zoom_level_hint = kInvalidZoomLevel,
+    metadata_decoding const decoding = metadata_decoding::eager) {
 
   uint64_t id = 0;
   std::pair<uint32_t, uint32_t> zoom_levels{kInvalidZoomLevel,
@@ -28,13 +89,16 @@ inline std::optional<feature> deserialize_feature(
 
   size_t meta_fill = 0;
   std::vector<metadata> meta;
+  char const* packed_meta_begin = nullptr;
+  char const* packed_meta_end = nullptr;
 
   std::vector<std::string_view> simplify_masks;
   fixed_geometry geometry;
 
   namespace pz = protozero;
   pz::pbf_message<tags::feature> msg{str.data(), str.size()};
-  while (msg.next()) {
+  for (auto const* field_begin = msg.m_data; msg.next();
+       field_begin = msg.m_data) {
     switch (msg.tag()) {
       case tags::feature::packed_sint64_header: {
         auto range = msg.get_packed_sint64();
@@ -81,41 +145,30 @@ inline std::optional<feature> deserialize_feature(
       case tags::feature::required_uint64_id: id = msg.get_uint64(); break;
 
       case tags::feature::packed_uint64_meta_pairs:
-        utl::verify(meta.empty(),
-                    "meta_pairs must come before, meta keys/values!");
-        for (auto const packed_id : msg.get_packed_uint64()) {
-          meta.push_back(metadata_decoder.decode(packed_id));
-        }
-        meta_fill = meta.size();
-        break;
-
       case tags::feature::repeated_string_keys:
-        meta.emplace_back(msg.get_string(), std::string{});
-        break;
-
       case tags::feature::repeated_string_values:
-        utl::verify(meta_fill < meta.size(), "meta data imbalance! (a)");
-        meta[meta_fill++].value_ = msg.get_string();
+        if (decoding == metadata_decoding::lazy) {
+          // the metadata fields are serialized en bloc
+          utl::verify(packed_meta_begin == nullptr ||
+                          packed_meta_end == field_begin,
+                      "meta data fields not contiguous");
+          if (packed_meta_begin == nullptr) {
+            packed_meta_begin = field_begin;
+          }
+          msg.skip();
+          packed_meta_end = msg.m_data;
+        } else {
+          read_metadata_field(msg, metadata_decoder, meta, meta_fill);
+        }
         break;
 
       case tags::feature::repeated_string_simplify_masks:
-        simplify_masks.emplace_back(msg.get_view());
-        break;
-
-      case tags::feature::required_fixed_geometry_geometry: {
-        std::vector<std::string_view> simplify_masks_tmp;
-        std::swap(simplify_masks, simplify_masks_tmp);
-        if (zoom_level_hint != kInvalidZoomLevel &&
-            !simplify_masks_tmp.empty()) {
-          geometry = deserialize(msg.get_view(), std::move(simplify_masks_tmp),
-                                 zoom_level_hint);
-          if (mpark::holds_alternative<fixed_null>(geometry)) {
-            return std::nullopt;  // killed by mask
-          }
-        } else {
-          geometry = deserialize(msg.get_view());
+      case tags::feature::required_fixed_geometry_geometry:
+        if (!read_geometry_field(msg, zoom_level_hint, simplify_masks,
+                                 geometry)) {
+          return std::nullopt;
         }
-      } break;
+        break;
 
       default: msg.skip();
     }
@@ -124,7 +177,138 @@ inline std::optional<feature> deserialize_feature(
   utl::verify(meta_fill == meta.size(), "meta data imbalance! (b)");
   utl::verify(layer != kInvalidLayer, "invalid layer found!");
 
-  return feature{id, layer, zoom_levels, std::move(meta), std::move(geometry)};
+  auto packed_meta = packed_metadata{};
+  if (packed_meta_begin != nullptr) {
+    packed_meta.fields_ = {
+        packed_meta_begin,
+        static_cast<size_t>(packed_meta_end - packed_meta_begin)};
+    packed_meta.decoder_ = &metadata_decoder;
+  }
+
+  return feature{id,
+                 layer,
+                 zoom_levels,
+                 std::move(meta),
+                 std::move(geometry),
+                 packed_meta};
+}
+
+// v3: the columns are read in the order of their rejection potential
+// (header, geometry), the metadata only for features which are returned
+inline std::optional<feature> deserialize_feature(
+    columnar_feature const& f,  //
+    shared_metadata_decoder const& metadata_decoder,
+    fixed_box const& box_hint = {{kInvalidBoxHint, kInvalidBoxHint},
+                                 {kInvalidBoxHint, kInvalidBoxHint}},
+    uint32_t const zoom_level_hint = kInvalidZoomLevel,
+    metadata_decoding const decoding = metadata_decoding::eager) {
+  auto const& columns = *f.columns_;
+
+  auto const [min_z, max_z] = columns.skip_index_.zoom_levels(f.idx_);
+  if (zoom_level_hint != kInvalidZoomLevel &&
+      (min_z > zoom_level_hint || max_z < zoom_level_hint)) {
+    return std::nullopt;
+  }
+
+  auto const [min_x, min_y, max_x, max_y] = columns.skip_index_.box(f.idx_);
+  if (box_hint.min_corner().x() != kInvalidBoxHint &&
+      box_hint.max_corner().x() != kInvalidBoxHint &&
+      (max_x < box_hint.min_corner().x() ||
+       min_x > box_hint.max_corner().x())) {
+    return std::nullopt;
+  }
+  if (box_hint.min_corner().y() != kInvalidBoxHint &&
+      box_hint.max_corner().y() != kInvalidBoxHint &&
+      (max_y < box_hint.min_corner().y() ||
+       min_y > box_hint.max_corner().y())) {
+    return std::nullopt;
+  }
+
+  std::vector<std::string_view> simplify_masks;
+  fixed_geometry geometry;
+  protozero::pbf_message<tags::feature> geo_msg{f.geometry_.data(),
+                                                f.geometry_.size()};
+  while (geo_msg.next()) {
+    if (!read_geometry_field(geo_msg, zoom_level_hint, simplify_masks,
+                             geometry)) {
+      return std::nullopt;
+    }
+  }
+
+  auto const meta_str = columns.meta(f.idx_);
+  if (decoding == metadata_decoding::lazy) {
+    return feature{columns.id(f.idx_),
+                   columns.layer(f.idx_),
+                   {min_z, max_z},
+                   {},
+                   std::move(geometry),
+                   {meta_str, &metadata_decoder}};
+  }
+
+  size_t meta_fill = 0;
+  std::vector<metadata> meta;
+  protozero::pbf_message<tags::feature> meta_msg{meta_str.data(),
+                                                 meta_str.size()};
+  while (meta_msg.next()) {
+    read_metadata_field(meta_msg, metadata_decoder, meta, meta_fill);
+  }
+  utl::verify(meta_fill == meta.size(), "meta data imbalance! (b)");
+
+  return feature{columns.id(f.idx_),
+                 columns.layer(f.idx_),
+                 {min_z, max_z},
+                 std::move(meta),
+                 std::move(geometry)};
+}
+
+// all metadata of the feature, packed metadata is resolved on the fly:
+//  - shared(uint64_t id, shared_metadata_decoder const&) for shared pairs
+//  - uncoded(std::string_view key, std::string_view value) for the rest
+template <typename SharedFn, typename UncodedFn>
+void for_each_metadata(feature const& f, SharedFn&& shared,
+                       UncodedFn&& uncoded) {
+  for (auto const& m : f.meta_) {
+    uncoded(std::string_view{m.key_}, std::string_view{m.value_});
+  }
+
+  auto const& fields = f.packed_meta_.fields_;
+  if (fields.empty()) {
+    return;
+  }
+
+  namespace pz = protozero;
+  pz::pbf_message<tags::feature> msg{fields.data(), fields.size()};
+  pz::pbf_message<tags::feature> values{fields.data(), fields.size()};
+  while (msg.next()) {
+    switch (msg.tag()) {
+      case tags::feature::packed_uint64_meta_pairs:
+        for (auto const packed_id : msg.get_packed_uint64()) {
+          shared(packed_id, *f.packed_meta_.decoder_);
+        }
+        break;
+
+      case tags::feature::repeated_string_keys: {
+        auto const key = std::string_view{msg.get_view()};
+        utl::verify(values.next(tags::feature::repeated_string_values),
+                    "meta data imbalance! (a)");
+        uncoded(key, std::string_view{values.get_view()});
+      } break;
+
+      default: msg.skip();
+    }
+  }
+}
+
+// fn(std::string_view key, std::string_view value) for all metadata
+template <typename Fn>
+void for_each_metadata(feature const& f, Fn&& fn) {
+  for_each_metadata(
+      f,
+      [&](uint64_t const id, shared_metadata_decoder const& decoder) {
+        auto const& m = decoder.decode(id);
+        fn(std::string_view{m.key_}, std::string_view{m.value_});
+      },
+      fn);
 }
 
 }  // namespace tiles
@@ -2,6 +2,7 @@
 
 #include <map>
 #include <string>
+#include <string_view>
 #include <utility>
 
 #include "protozero/types.hpp"
@@ -18,12 +19,28 @@ constexpr uint32_t kInvalidZoomLevel = 0x3F;  // 63; max for one byte in svarint
 constexpr fixed_coord_t kInvalidBoxHint =
     std::numeric_limits<fixed_coord_t>::max();
 
+struct shared_metadata_decoder;
+
+// Metadata still encoded as in the feature pack (pairs, keys and values
+// fields), resolved only when needed (see for_each_metadata). Points into
+// the pack and to the decoder: both must outlive it.
+struct packed_metadata {
+  std::string_view fields_;
+  shared_metadata_decoder const* decoder_{nullptr};
+};
+
+enum class metadata_decoding : uint8_t {
+  eager,  // into feature::meta_
+  lazy  // into feature::packed_meta_
+};
+
 struct feature {
   uint64_t id_{kInvalidFeatureId};
   size_t layer_{kInvalidLayerId};
   std::pair<uint32_t, uint32_t> zoom_levels_;
   std::vector<metadata> meta_;
   fixed_geometry geometry_;
+  packed_metadata packed_meta_{};  // in addition to meta_
 };
 
 namespace tags {
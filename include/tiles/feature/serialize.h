@@ -13,33 +13,10 @@
 
 namespace tiles {
 
-inline std::string serialize_feature(
-    feature const& f, shared_metadata_coder const& metadata_coder = {},
-    bool fast = true) {
-  std::string buf;
-  protozero::pbf_builder<tags::feature> pb(buf);
-
-  auto const box = bounding_box(f.geometry_);
-
-  // XXX: maybe tile dependent offsets would be more compact!
-  delta_encoder x_enc{kFixedCoordMagicOffset};
-  delta_encoder y_enc{kFixedCoordMagicOffset};
-
-  std::array<int64_t, 7> header{{
-      f.zoom_levels_.first,  // 0: min zoom level
-      f.zoom_levels_.second,  // 1:  max zoom level
-      x_enc.encode(box.min_corner().x()),  // 2
-      x_enc.encode(box.max_corner().x()),  // 3
-      y_enc.encode(box.min_corner().y()),  // 4
-      y_enc.encode(box.max_corner().y()),  // 5
-      static_cast<int64_t>(f.layer_)  // 6
-  }};
-
-  pb.add_packed_sint64(tags::feature::packed_sint64_header,  //
-                       begin(header), end(header));
-
-  pb.add_uint64(tags::feature::required_uint64_id, f.id_);
-
+inline void serialize_metadata(protozero::pbf_builder<tags::feature>& pb,
+                               feature const& f,
+                               shared_metadata_coder const& metadata_coder,
+                               bool const fast) {
   if (!fast) {
     std::vector<size_t> coded_metas;
     std::vector<std::string> uncoded_keys, uncoded_values;
@@ -72,7 +49,10 @@ inline std::string serialize_feature(
       pb.add_string(tags::feature::repeated_string_values, m.value_);
     }
   }
+}
 
+inline void serialize_geometry(protozero::pbf_builder<tags::feature>& pb,
+                               feature const& f, bool const fast) {
   if (!fast) {
     for (auto const& mask : make_simplify_mask(f.geometry_)) {
       pb.add_string(tags::feature::repeated_string_simplify_masks, mask);
@@ -81,6 +61,37 @@ inline std::string serialize_feature(
 
   pb.add_message(tags::feature::required_fixed_geometry_geometry,
                  serialize(f.geometry_));
+}
+
+inline std::string serialize_feature(
+    feature const& f, shared_metadata_coder const& metadata_coder = {},
+    bool fast = true) {
+  std::string buf;
+  protozero::pbf_builder<tags::feature> pb(buf);
+
+  auto const box = bounding_box(f.geometry_);
+
+  // XXX: maybe tile dependent offsets would be more compact!
+  delta_encoder x_enc{kFixedCoordMagicOffset};
+  delta_encoder y_enc{kFixedCoordMagicOffset};
+
+  std::array<int64_t, 7> header{{
+      f.zoom_levels_.first,  // 0: min zoom level
+      f.zoom_levels_.second,  // 1:  max zoom level
+      x_enc.encode(box.min_corner().x()),  // 2
+      x_enc.encode(box.max_corner().x()),  // 3
+      y_enc.encode(box.min_corner().y()),  // 4
+      y_enc.encode(box.max_corner().y()),  // 5
+      static_cast<int64_t>(f.layer_)  // 6
+  }};
+
+  pb.add_packed_sint64(tags::feature::packed_sint64_header,  //
+                       begin(header), end(header));
+
+  pb.add_uint64(tags::feature::required_uint64_id, f.id_);
+
+  serialize_metadata(pb, f, metadata_coder, fast);
+  serialize_geometry(pb, f, fast);
 
   return buf;
 }
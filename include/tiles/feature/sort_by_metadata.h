@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace tiles {
+
+struct feature;
+
+// Sorts features by their metadata (then by id) and returns the number of
+// features of each run with equal metadata, in order.
+//
+// Compares the decoded (key, value) pairs in their stored order, like
+// eagerly decoded meta_ vectors: the same tags may be stored eagerly or
+// packed, and packs from other encoders (quick / optimal, v2 / v3) encode
+// them differently. Does not allocate per feature.
+std::vector<size_t> sort_by_metadata(std::vector<feature>&);
+
+}  // namespace tiles
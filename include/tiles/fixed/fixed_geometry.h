@@ -13,6 +13,7 @@
 #include "mpark/variant.hpp"
 
 #include "tiles/constants.h"
+#include "tiles/fixed/geometry_allocator.h"
 
 namespace tiles {
 
@@ -24,8 +25,13 @@ const fixed_xy invalid_xy{std::numeric_limits<fixed_coord_t>::max(),
                           std::numeric_limits<fixed_coord_t>::max()};
 
 using fixed_box = boost::geometry::model::box<fixed_xy>;
-using fixed_line = boost::geometry::model::linestring<fixed_xy>;
-using fixed_simple_polygon = boost::geometry::model::polygon<fixed_xy>;
+using fixed_line =
+    boost::geometry::model::linestring<fixed_xy, std::vector,
+                                       geometry_allocator>;
+using fixed_simple_polygon =
+    boost::geometry::model::polygon<fixed_xy, true, true, std::vector,
+                                    std::vector, geometry_allocator,
+                                    geometry_allocator>;
 using fixed_ring = fixed_simple_polygon::ring_type;
 
 constexpr fixed_coord_t kFixedCoordMin = 0;
@@ -38,10 +44,15 @@ static_assert(kFixedDefaultZoomLevel <= kMaxZoomLevel, "invalid default zoom");
 using fixed_delta_t = int64_t;
 
 using fixed_null = std::monostate;
-using fixed_point = boost::geometry::model::multi_point<fixed_xy>;
-using fixed_polyline = boost::geometry::model::multi_linestring<fixed_line>;
+using fixed_point =
+    boost::geometry::model::multi_point<fixed_xy, std::vector,
+                                        geometry_allocator>;
+using fixed_polyline =
+    boost::geometry::model::multi_linestring<fixed_line, std::vector,
+                                             geometry_allocator>;
 using fixed_polygon =
-    boost::geometry::model::multi_polygon<fixed_simple_polygon>;
+    boost::geometry::model::multi_polygon<fixed_simple_polygon, std::vector,
+                                          geometry_allocator>;
 
 using fixed_geometry =
     mpark::variant<fixed_null, fixed_point, fixed_polyline, fixed_polygon>;
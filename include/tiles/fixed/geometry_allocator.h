@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+
+namespace tiles {
+
+// Bump allocator for the geometry of one tile.
+//
+// Deallocation is a no-op, reset() rewinds to the first chunk. Chunks are
+// kept for the next tile (up to kMaxRetainedBytes), so steady-state
+// rendering does not touch malloc for geometry at all.
+struct geometry_arena : public std::pmr::memory_resource {
+  static constexpr auto const kMinChunkSize = size_t{64} * 1024;
+  static constexpr auto const kMaxRetainedBytes = size_t{64} * 1024 * 1024;
+
+  void reset();
+
+private:
+  struct chunk {
+    std::unique_ptr<std::byte[]> data_;
+    size_t size_;
+  };
+
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void*, size_t, size_t) override {}
+  bool do_is_equal(std::pmr::memory_resource const& o) const noexcept override {
+    return this == &o;
+  }
+
+  std::vector<chunk> chunks_;
+  size_t curr_chunk_{0};
+  size_t curr_offset_{0};
+};
+
+// resource used by geometry_allocators created on this thread
+// (new/delete unless a geometry_arena_scope is active)
+std::pmr::memory_resource*& current_geometry_resource();
+
+// Activates the thread local geometry_arena. Leaving the outermost scope
+// resets the arena: no geometry created inside may be used afterwards.
+struct geometry_arena_scope {
+  geometry_arena_scope();
+  ~geometry_arena_scope();
+
+  geometry_arena_scope(geometry_arena_scope const&) = delete;
+  geometry_arena_scope(geometry_arena_scope&&) = delete;
+  geometry_arena_scope& operator=(geometry_arena_scope const&) = delete;
+  geometry_arena_scope& operator=(geometry_arena_scope&&) = delete;
+
+  std::pmr::memory_resource* prev_;
+  bool outermost_;
+};
+
+// Allocator for the fixed_* geometry containers. It captures the current
+// geometry resource of the thread when the container is created. Copies
+// use the resource which is current at the time of the copy.
+//
+// The allocator never propagates on assignment or swap: a container keeps
+// the resource it was created with. Moving arena geometry into a container
+// from outside the arena scope (e.g. one which lives longer) therefore
+// moves the elements into that container's own memory instead of handing
+// it memory which is gone once the arena is reset. Swapping containers of
+// different resources is not allowed (checked by _GLIBCXX_ASSERTIONS).
+template <typename T>
+struct geometry_allocator {
+  using value_type = T;
+
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::false_type;
+  using propagate_on_container_swap = std::false_type;
+  using is_always_equal = std::false_type;
+
+  geometry_allocator() noexcept : resource_{current_geometry_resource()} {}
+
+  template <typename U>
+  // NOLINTNEXTLINE(google-explicit-constructor)
+  geometry_allocator(geometry_allocator<U> const& o) noexcept
+      : resource_{o.resource_} {}
+
+  T* allocate(size_t const n) {
+    return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* ptr, size_t const n) noexcept {
+    resource_->deallocate(ptr, n * sizeof(T), alignof(T));
+  }
+
+  geometry_allocator select_on_container_copy_construction() const noexcept {
+    return geometry_allocator{};
+  }
+
+  template <typename U>
+  friend bool operator==(geometry_allocator const& a,
+                         geometry_allocator<U> const& b) noexcept {
+    return a.resource_ == b.resource_;
+  }
+
+  template <typename U>
+  friend bool operator!=(geometry_allocator const& a,
+                         geometry_allocator<U> const& b) noexcept {
+    return a.resource_ != b.resource_;
+  }
+
+  std::pmr::memory_resource* resource_;
+};
+
+}  // namespace tiles
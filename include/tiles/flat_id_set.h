@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace tiles {
+
+// Open addressing hash set for (osm) ids.
+//
+// Unlike std::unordered_set, clear() keeps the memory: a set which is reused
+// for many tiles stops allocating once it has seen the largest tile.
+struct flat_id_set {
+  static constexpr auto const kEmpty = std::numeric_limits<uint64_t>::max();
+
+  // returns true if the id was not in the set before
+  bool insert(uint64_t const id) {
+    if (id == kEmpty) {
+      auto const inserted = !has_empty_key_;
+      has_empty_key_ = true;
+      return inserted;
+    }
+
+    if ((size_ + 1) * 2 > slots_.size()) {
+      grow();
+    }
+
+    auto const mask = slots_.size() - 1;
+    for (auto i = hash(id) & mask;; i = (i + 1) & mask) {
+      if (slots_[i] == id) {
+        return false;
+      } else if (slots_[i] == kEmpty) {
+        slots_[i] = id;
+        ++size_;
+        return true;
+      }
+    }
+  }
+
+  void clear() {
+    if (size_ != 0) {
+      std::fill(begin(slots_), end(slots_), kEmpty);
+    }
+    size_ = 0;
+    has_empty_key_ = false;
+  }
+
+  size_t size() const { return size_ + (has_empty_key_ ? 1 : 0); }
+
+private:
+  static uint64_t hash(uint64_t x) {  // splitmix64 finalizer
+    x = (x ^ (x >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27U)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31U);
+  }
+
+  void grow() {
+    auto old = std::move(slots_);
+    slots_.assign(old.empty() ? 64 : old.size() * 2, kEmpty);
+    size_ = 0;
+    for (auto const id : old) {
+      if (id != kEmpty) {
+        insert(id);
+      }
+    }
+  }
+
+  std::vector<uint64_t> slots_;
+  size_t size_{0};
+  bool has_empty_key_{false};
+};
+
+}  // namespace tiles
@@ -3,6 +3,7 @@
 #include "geo/tile.h"
 #include "lmdb/lmdb.hpp"
 
+#include "tiles/cancel_token.h"
 #include "tiles/db/bq_tree.h"
 #include "tiles/db/feature_pack.h"
 #include "tiles/db/layer_names.h"
@@ -12,9 +13,12 @@
 #include "tiles/db/tile_index.h"
 #include "tiles/feature/deserialize.h"
 #include "tiles/fixed/algo/bounding_box.h"
+#include "tiles/fixed/geometry_allocator.h"
 #include "tiles/mvt/tile_builder.h"
 #include "tiles/mvt/tile_spec.h"
 #include "tiles/perf_counter.h"
+#include "tiles/util.h"
+#include "tiles/zoom_band.h"
 
 #include "boost/geometry.hpp"
 
@@ -28,6 +32,7 @@ struct render_ctx {
   shared_metadata_decoder metadata_decoder_;
 
   bool compress_result_ = true;
+  std::vector<zoom_band> compression_levels_{};  // default: see util.h
   bool ignore_prepared_ = false;
   bool ignore_fully_seaside_ = false;
 
@@ -36,6 +41,12 @@ struct render_ctx {
   bool tb_aggregate_polygons_ = false;
   bool tb_drop_subpixel_polygons_ = true;
   bool tb_print_stats_ = false;
+
+  // per zoom level (see prepare_seaside_tile_blobs)
+  std::vector<std::string> seaside_tile_blobs_{};
+
+  // not available for databases from older imports
+  std::optional<bq_tree> content_tiles_{};
 };
 
 inline render_ctx make_render_ctx(tile_db_handle& db_handle) {
@@ -44,11 +55,51 @@ inline render_ctx make_render_ctx(tile_db_handle& db_handle) {
 
   auto opt_max_prep = txn.get(meta_dbi, kMetaKeyMaxPreparedZoomLevel);
   auto opt_seaside = txn.get(meta_dbi, kMetaKeyFullySeasideTree);
+  auto opt_content = txn.get(meta_dbi, kMetaKeyContentTree);
+
+  render_ctx ctx{opt_max_prep ? std::stoi(std::string{*opt_max_prep}) : -1,
+                 opt_seaside ? bq_tree{*opt_seaside} : bq_tree{},
+                 get_layer_names(db_handle, txn),
+                 make_shared_metadata_decoder(db_handle, txn)};
+  if (opt_content) {
+    ctx.content_tiles_ = bq_tree{*opt_content};
+  }
+  return ctx;
+}
+
+// O(z) check without the feature index: false if the tile is empty for sure
+inline bool may_have_content(render_ctx const& ctx, geo::tile const& tile) {
+  return !ctx.content_tiles_.has_value() ||
+         ctx.content_tiles_->intersects(tile) ||
+         ctx.seaside_tiles_.intersects(tile);
+}
+
+// O(z) check without the feature index: true if the tile is fully seaside
+// and has no pack records for sure (i.e. it is exactly the seaside blob)
+inline bool is_empty_seaside_tile(render_ctx const& ctx,
+                                  geo::tile const& tile) {
+  return ctx.content_tiles_.has_value() &&
+         !ctx.content_tiles_->intersects(tile) &&
+         ctx.seaside_tiles_.contains(tile);
+}
 
-  return {opt_max_prep ? std::stoi(std::string{*opt_max_prep}) : -1,
-          opt_seaside ? bq_tree{*opt_seaside} : bq_tree{},
-          get_layer_names(db_handle, txn),
-          make_shared_metadata_decoder(db_handle, txn)};
+inline feature make_seaside_feature(geo::tile const& seaside_tile,
+                                    uint64_t const id) {
+  auto const bounds = tile_spec{seaside_tile}.draw_bounds_;
+
+  fixed_simple_polygon polygon{
+      {{bounds.min_corner().x(), bounds.min_corner().y()},
+       {bounds.min_corner().x(), bounds.max_corner().y()},
+       {bounds.max_corner().x(), bounds.max_corner().y()},
+       {bounds.max_corner().x(), bounds.min_corner().y()},
+       {bounds.min_corner().x(), bounds.min_corner().y()}}};
+  boost::geometry::correct(polygon);
+
+  return {id,
+          kLayerCoastlineIdx,
+          std::pair<uint32_t, uint32_t>{0, kMaxZoomLevel + 1},
+          {{"layer", "coastline"}},
+          fixed_polygon{std::move(polygon)}};
 }
 
 template <typename PerfCounter>
@@ -58,78 +109,126 @@ void render_seaside(tile_builder& builder, render_ctx const& ctx,
   auto const& seaside_tiles = ctx.seaside_tiles_.all_leafs(tile);
   stop<perf_task::RENDER_TILE_FIND_SEASIDE>(pc);
 
-  for (auto const& seaside_tile : seaside_tiles) {
-    auto const bounds = tile_spec{seaside_tile}.draw_bounds_;
-
-    fixed_simple_polygon polygon{
-        {{bounds.min_corner().x(), bounds.min_corner().y()},
-         {bounds.min_corner().x(), bounds.max_corner().y()},
-         {bounds.max_corner().x(), bounds.max_corner().y()},
-         {bounds.max_corner().x(), bounds.min_corner().y()},
-         {bounds.min_corner().x(), bounds.min_corner().y()}}};
-    boost::geometry::correct(polygon);
+  // fully seaside: the same feature for every tile of the zoom level
+  auto const fully_seaside = seaside_tiles.size() == 1 &&
+                             seaside_tiles.front() == tile;
 
+  for (auto const& seaside_tile : seaside_tiles) {
     start<perf_task::RENDER_TILE_ADD_SEASIDE>(pc);
-    builder.add_feature({tile_to_key(seaside_tile),
-                         kLayerCoastlineIdx,
-                         std::pair<uint32_t, uint32_t>{0, kMaxZoomLevel + 1},
-                         {{"layer", "coastline"}},
-                         fixed_polygon{std::move(polygon)}});
+    builder.add_feature(make_seaside_feature(
+        seaside_tile, fully_seaside ? 0 : tile_to_key(seaside_tile)));
     stop<perf_task::RENDER_TILE_ADD_SEASIDE>(pc);
   }
 }
 
-template <typename Fn>
-void pack_records_foreach(lmdb::cursor& c, geo::tile const& query_tile,
-                          Fn&& fn) {
-  // XXX not working on zoom level zero "whole database" ?!
-  auto const bounds = query_tile.bounds_on_z(kTileDefaultIndexZoomLvl);
-  for (auto y = bounds.miny_; y < bounds.maxy_; ++y) {
-    auto const key_begin =
-        tile_to_key(bounds.minx_, y, kTileDefaultIndexZoomLvl);
-    auto const key_end = tile_to_key(bounds.maxx_, y, kTileDefaultIndexZoomLvl);
+inline std::string compress_tile(render_ctx const& ctx, geo::tile const& tile,
+                                 std::string const& rendered_tile) {
+  return compress_deflate(
+      rendered_tile, get_zoom_band_value(ctx.compression_levels_, tile.z_)
+                         .value_or(kDefaultCompressionLevel));
+}
 
+// A fully seaside tile without features consists of one coastline
+// polygon covering the draw bounds. In tile coordinates, this is the same
+// for every tile of a zoom level: render (and compress) it once per zoom
+// level. Requires the final compression settings of the render_ctx.
+//
+// The coastline feature of these tiles has the id 0 instead of the tile
+// key (feature ids only need to be unique within a tile).
+//
+// Not with debug info: it differs from tile to tile.
+inline void prepare_seaside_tile_blobs(render_ctx& ctx) {
+  ctx.seaside_tile_blobs_.clear();
+  if (ctx.tb_render_debug_info_) {
+    return;
+  }
+  for (auto z = 0U; z <= kMaxZoomLevel; ++z) {
+    auto const tile = geo::tile{0, 0, z};
+
+    geometry_arena_scope arena;
+    tile_builder builder{ctx, tile};
+    builder.add_feature(make_seaside_feature(tile, 0));
+    auto const& rendered_tile = builder.finish();
+    ctx.seaside_tile_blobs_.emplace_back(
+        ctx.compress_result_ ? compress_tile(ctx, tile, rendered_tile)
+                             : rendered_tile);
+  }
+}
+
+template <typename Fn>
+void pack_records_foreach(tile_key_layout const layout, lmdb::cursor& c,
+                          geo::tile const& query_tile, Fn&& fn) {
+  auto const scan = [&](tile_key_t const key_begin, tile_key_t const key_end) {
     for (auto el = c.get(lmdb::cursor_op::SET_RANGE, key_begin);
          el && el->first < key_end;
          el = c.get<decltype(key_begin)>(lmdb::cursor_op::NEXT)) {
 
-      auto const result_tile = key_to_tile(el->first);
+      auto const result_tile = key_to_tile(layout, el->first);
       pack_records_foreach(el->second, [&](auto const& pack_record) {
         fn(result_tile, pack_record);
       });
     }
+  };
+
+  // z-order: all index tiles below the query tile are one key range
+  if (layout == tile_key_layout::morton) {
+    auto const [key_begin, key_end] =
+        morton_key_range(query_tile, kTileDefaultIndexZoomLvl);
+    scan(key_begin, key_end);
+    return;
+  }
+
+  // XXX not working on zoom level zero "whole database" ?!
+  auto const bounds = query_tile.bounds_on_z(kTileDefaultIndexZoomLvl);
+  for (auto y = bounds.miny_; y < bounds.maxy_; ++y) {
+    scan(tile_to_key(bounds.minx_, y, kTileDefaultIndexZoomLvl),
+         tile_to_key(bounds.maxx_, y, kTileDefaultIndexZoomLvl));
   }
 }
 
+// per pack and every n-th feature: the deadline check reads the clock
+constexpr auto const kFeatureCancelCheckInterval = 64U;
+
 template <typename ForeachPack, typename PerfCounter>
 size_t render_features(tile_builder& builder, render_ctx const& ctx,
                        geo::tile const& tile, ForeachPack&& foreach_pack,
-                       PerfCounter& pc) {
+                       PerfCounter& pc, cancel_token const& cancel) {
   size_t added_features = 0;
+  auto unchecked_features = 0U;
   auto const box = tile_spec{tile}.draw_bounds_;  // XXX really with overdraw?
+  auto const skip_query = std::make_optional<feature_skip_query>(
+      tile.z_, box.min_corner().x(), box.min_corner().y(),
+      box.max_corner().x(), box.max_corner().y());
 
   start<perf_task::RENDER_TILE_QUERY_FEATURE>(pc);
   foreach_pack([&](auto const& db_tile, auto const& pack_str) {
     stop<perf_task::RENDER_TILE_QUERY_FEATURE>(pc);
     stop<perf_task::RENDER_TILE_ITER_FEATURE>(pc);
-
-    unpack_features(db_tile, pack_str, tile, [&](auto const& feature_str) {
-      start<perf_task::RENDER_TILE_DESER_FEATURE_OKAY>(pc);
-      start<perf_task::RENDER_TILE_DESER_FEATURE_SKIP>(pc);
-      auto const feature =
-          deserialize_feature(feature_str, ctx.metadata_decoder_, box, tile.z_);
-      if (!feature) {
-        stop<perf_task::RENDER_TILE_DESER_FEATURE_SKIP>(pc);
-        start<perf_task::RENDER_TILE_ITER_FEATURE>(pc);
-        return;
-      }
-      stop<perf_task::RENDER_TILE_DESER_FEATURE_OKAY>(pc);
-
-      start<perf_task::RENDER_TILE_ADD_FEATURE>(pc);
-      builder.add_feature(std::move(*feature));
-      ++added_features;
-      stop<perf_task::RENDER_TILE_ADD_FEATURE>(pc);
-    });
+    cancel.throw_if_cancelled();
+
+    unpack_features(
+        db_tile, pack_str, tile, skip_query, [&](auto const& feature_str) {
+          if (++unchecked_features == kFeatureCancelCheckInterval) {
+            unchecked_features = 0;
+            cancel.throw_if_cancelled();
+          }
+          start<perf_task::RENDER_TILE_DESER_FEATURE_OKAY>(pc);
+          start<perf_task::RENDER_TILE_DESER_FEATURE_SKIP>(pc);
+          auto const feature =
+              deserialize_feature(feature_str, ctx.metadata_decoder_, box,
+                                  tile.z_, metadata_decoding::lazy);
+          if (!feature) {
+            stop<perf_task::RENDER_TILE_DESER_FEATURE_SKIP>(pc);
+            start<perf_task::RENDER_TILE_ITER_FEATURE>(pc);
+            return;
+          }
+          stop<perf_task::RENDER_TILE_DESER_FEATURE_OKAY>(pc);
+
+          start<perf_task::RENDER_TILE_ADD_FEATURE>(pc);
+          builder.add_feature(std::move(*feature));
+          ++added_features;
+          stop<perf_task::RENDER_TILE_ADD_FEATURE>(pc);
+        });
 
     start<perf_task::RENDER_TILE_ITER_FEATURE>(pc);
   });
@@ -137,22 +236,46 @@ size_t render_features(tile_builder& builder, render_ctx const& ctx,
 }
 
 template <typename ForeachPack, typename PerfCounter>
-std::optional<std::string> get_tile(render_ctx const& ctx,
-                                    geo::tile const& tile,
-                                    ForeachPack&& foreach_pack,
-                                    PerfCounter& pc) {
+std::optional<std::string> get_tile(
+    render_ctx const& ctx, geo::tile const& tile, ForeachPack&& foreach_pack,
+    PerfCounter& pc, cancel_token const& cancel = never_cancelled()) {
+  scoped_allocation_counter<PerfCounter> allocations{pc};
+
+  auto const seaside_blob = [&]() -> std::optional<std::string> {
+    if (ctx.ignore_fully_seaside_) {
+      return std::nullopt;
+    }
+    auto const& blob = ctx.seaside_tile_blobs_.at(tile.z_);
+    pc.template append<perf_task::RESULT_SIZE>(blob.size());
+    return blob;
+  };
+
+  // neither builder nor index needed (with the content tree)
+  if ((ctx.ignore_fully_seaside_ || !ctx.seaside_tile_blobs_.empty()) &&
+      is_empty_seaside_tile(ctx, tile)) {
+    return seaside_blob();
+  }
+
   start<perf_task::GET_TILE_RENDER>(pc);
 
+  // all geometry of this tile is released at once when the scope ends
+  // (declared before the builder: its buffers must be gone by then)
+  geometry_arena_scope arena;
   tile_builder builder{ctx, tile};
   render_seaside(builder, ctx, tile, pc);
-  auto const rendered_features = render_features(
-      builder, ctx, tile, std::forward<ForeachPack>(foreach_pack), pc);
-
-  if (ctx.ignore_fully_seaside_ && ctx.seaside_tiles_.contains(tile) &&
-      rendered_features == 0) {
-    return std::nullopt;
+  auto const rendered_features =
+      render_features(builder, ctx, tile,
+                      std::forward<ForeachPack>(foreach_pack), pc, cancel);
+
+  // otherwise decided after the (single) index walk: no extra probe
+  if (rendered_features == 0 && ctx.seaside_tiles_.contains(tile) &&
+      (ctx.ignore_fully_seaside_ || !ctx.seaside_tile_blobs_.empty())) {
+    stop<perf_task::GET_TILE_RENDER>(pc);
+    return seaside_blob();
   }
 
+  cancel.throw_if_cancelled();
+
   start<perf_task::RENDER_TILE_FINISH>(pc);
   auto rendered_tile = builder.finish();
   stop<perf_task::RENDER_TILE_FINISH>(pc);
@@ -165,7 +288,7 @@ std::optional<std::string> get_tile(render_ctx const& ctx,
 
   if (ctx.compress_result_) {
     start<perf_task::GET_TILE_COMPRESS>(pc);
-    auto compressed = compress_deflate(rendered_tile);
+    auto compressed = compress_tile(ctx, tile, rendered_tile);
     stop<perf_task::GET_TILE_COMPRESS>(pc);
     pc.template append<perf_task::RESULT_SIZE>(compressed.size());
     return {std::move(compressed)};
@@ -175,55 +298,140 @@ std::optional<std::string> get_tile(render_ctx const& ctx,
   }
 }
 
+inline bool is_prepared_zoom_level(render_ctx const& ctx,
+                                   geo::tile const& tile) {
+  return !ctx.ignore_prepared_ &&
+         static_cast<int>(tile.z_) <= ctx.max_prepared_zoom_level_;
+}
+
+// the returned view points into the database and is only valid as long as
+// the transaction is alive
+template <typename PerfCounter>
+std::optional<std::string_view> get_prepared_tile(tile_db_handle& handle,
+                                                  lmdb::txn& txn,
+                                                  geo::tile const& tile,
+                                                  PerfCounter& pc) {
+  auto tiles_dbi = handle.tiles_dbi(txn);
+
+  start<perf_task::GET_TILE_FETCH>(pc);
+  auto db_tile = txn.get(tiles_dbi, tile_to_key(tile));
+  stop<perf_task::GET_TILE_FETCH>(pc);
+
+  return db_tile;
+}
+
 template <typename PerfCounter>
 std::optional<std::string> get_tile(tile_db_handle& handle, lmdb::txn& txn,
                                     lmdb::cursor& features_cursor,
                                     pack_handle const& pack_handle,
                                     render_ctx const& ctx,
-                                    geo::tile const& tile, PerfCounter& pc) {
+                                    geo::tile const& tile, PerfCounter& pc,
+                                    cancel_token const& cancel =
+                                        never_cancelled()) {
   utl::verify(tile.z_ <= kMaxZoomLevel, "invalid zoom level {}", tile.z_);
 
   auto total = scoped_perf_counter<perf_task::GET_TILE_TOTAL>(pc);
 
-  if (!ctx.ignore_prepared_ &&
-      static_cast<int>(tile.z_) <= ctx.max_prepared_zoom_level_) {
-    auto tiles_dbi = handle.tiles_dbi(txn);
-
-    start<perf_task::GET_TILE_FETCH>(pc);
-    auto db_tile = txn.get(tiles_dbi, tile_to_key(tile));
-    stop<perf_task::GET_TILE_FETCH>(pc);
-
-    if (db_tile) {
+  if (is_prepared_zoom_level(ctx, tile)) {
+    if (auto const db_tile = get_prepared_tile(handle, txn, tile, pc);
+        db_tile) {
       return std::string{*db_tile};
     }
 
     if (ctx.seaside_tiles_.contains(tile)) {
-      return get_tile(ctx, tile, [](auto&&) {}, pc);
+      return get_tile(ctx, tile, [](auto&&) {}, pc, cancel);
     }
 
     return std::nullopt;
   }
 
+  if (!may_have_content(ctx, tile)) {
+    return std::nullopt;
+  }
+
   return get_tile(
       ctx, tile,
       [&](auto&& fn) {
-        pack_records_foreach(features_cursor, tile, [&](auto t, auto r) {
-          fn(t, pack_handle.get(r));
-        });
+        pack_records_foreach(
+            handle.feature_key_layout_, features_cursor, tile,
+            [&](auto t, auto r) { fn(t, pack_handle.get(r)); });
       },
-      pc);
+      pc, cancel);
+}
+
+// Renders several tiles below a common root tile (e.g. a metatile block)
+// in one transaction. The index is walked once for the root tile: every
+// overlapping pack record is looked up once and shared by all tiles.
+//
+// fn(tile, std::optional<std::string> rendered) is called for each tile
+// in the given order.
+template <typename PerfCounter, typename Fn>
+void get_tiles(tile_db_handle& handle, lmdb::txn& txn,
+               lmdb::cursor& features_cursor, pack_handle const& pack_handle,
+               render_ctx const& ctx, geo::tile const& root,
+               std::vector<geo::tile> const& tiles, Fn&& fn, PerfCounter& pc,
+               cancel_token const& cancel = never_cancelled()) {
+  utl::verify(root.z_ <= kMaxZoomLevel, "invalid zoom level {}", root.z_);
+  for (auto const& tile : tiles) {
+    auto const b = tile.bounds_on_z(root.z_);
+    utl::verify(tile.z_ >= root.z_ && tile.z_ <= kMaxZoomLevel &&
+                    b.minx_ == root.x_ && b.miny_ == root.y_,
+                "get_tiles: tile not below root");
+  }
+
+  std::optional<std::vector<std::pair<geo::tile, std::string_view>>> packs;
+  auto const get_packs = [&]() -> auto const& {
+    if (!packs) {
+      start<perf_task::GET_TILE_FETCH>(pc);
+      packs.emplace();
+      pack_records_foreach(handle.feature_key_layout_, features_cursor, root,
+                           [&](auto t, auto r) {
+                             packs->emplace_back(t, pack_handle.get(r));
+                           });
+      stop<perf_task::GET_TILE_FETCH>(pc);
+    }
+    return *packs;
+  };
+
+  for (auto const& tile : tiles) {
+    cancel.throw_if_cancelled();
+
+    // prepared tiles are single lookups, empty tiles need no index at all
+    if (is_prepared_zoom_level(ctx, tile) || !may_have_content(ctx, tile)) {
+      fn(tile, get_tile(handle, txn, features_cursor, pack_handle, ctx, tile,
+                        pc, cancel));
+      continue;
+    }
+
+    // same records (and order) as pack_records_foreach for this tile
+    auto const b = tile.bounds_on_z(kTileDefaultIndexZoomLvl);
+    auto const foreach_pack = [&](auto&& pack_fn) {
+      for (auto const& [db_tile, pack] : get_packs()) {
+        if (db_tile.x_ >= b.minx_ && db_tile.x_ < b.maxx_ &&
+            db_tile.y_ >= b.miny_ && db_tile.y_ < b.maxy_) {
+          pack_fn(db_tile, pack);
+        }
+      }
+    };
+
+    auto total = scoped_perf_counter<perf_task::GET_TILE_TOTAL>(pc);
+    fn(tile, get_tile(ctx, tile, foreach_pack, pc, cancel));
+  }
 }
 
 template <typename PerfCounter>
 std::optional<std::string> get_tile(tile_db_handle& db_handle,
                                     pack_handle const& pack_handle,
                                     render_ctx const& ctx,
-                                    geo::tile const& tile, PerfCounter& pc) {
+                                    geo::tile const& tile, PerfCounter& pc,
+                                    cancel_token const& cancel =
+                                        never_cancelled()) {
   auto txn = db_handle.make_txn();
   auto features_dbi = db_handle.features_dbi(txn);
   auto features_cursor = lmdb::cursor{txn, features_dbi};
 
-  return get_tile(db_handle, txn, features_cursor, pack_handle, ctx, tile, pc);
+  return get_tile(db_handle, txn, features_cursor, pack_handle, ctx, tile, pc,
+                  cancel);
 }
 
 }  // namespace tiles
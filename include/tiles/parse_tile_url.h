@@ -1,44 +1,43 @@
 #pragma once
 
+#include <charconv>
+#include <cstdint>
 #include <optional>
-
-#include "utl/helpers/algorithm.h"
-#include "utl/parser/split.h"
+#include <string_view>
 
 #include "geo/tile.h"
 
-#include "tiles/util.h"
-
 namespace tiles {
 
-inline std::optional<geo::tile> parse_tile_url(std::string url) {
-  std::reverse(begin(url), end(url));
-  if (!url.starts_with("tvm.")) {
+// ".../{z}/{x}/{y}.mvt" (decoded path, without query)
+inline std::optional<geo::tile> parse_tile_url(std::string_view url) {
+  constexpr auto const kSuffix = std::string_view{".mvt"};
+  if (!url.ends_with(kSuffix)) {
     return std::nullopt;
   }
-
-  auto const [z_rev, y_rev, x_rev] =
-      utl::split<'/', utl::cstr, utl::cstr, utl::cstr>(url.c_str() + 4);
-
-  for (auto const rev : {z_rev, y_rev, x_rev}) {
-    utl::verify(
-        rev.valid() &&
-            utl::all_of(rev, [](char const c) { return std::isdigit(c) != 0; }),
-        "invalid url {}", url);
+  url.remove_suffix(kSuffix.size());
+
+  // back to front: y, x, z
+  auto const parse_last = [&](uint32_t& value) {
+    auto const slash = url.rfind('/');
+    if (slash == std::string_view::npos) {
+      return false;
+    }
+    auto const digits = url.substr(slash + 1);
+    auto const [ptr, ec] =
+        std::from_chars(digits.data(), digits.data() + digits.size(), value);
+    url = url.substr(0, slash);
+    return !digits.empty() && ec == std::errc{} &&
+           ptr == digits.data() + digits.size();
+  };
+
+  auto x = uint32_t{0};
+  auto y = uint32_t{0};
+  auto z = uint32_t{0};
+  if (!parse_last(y) || !parse_last(x) || !parse_last(z)) {
+    return std::nullopt;
   }
-
-  std::reverse(const_cast<char*>(x_rev.str),
-               const_cast<char*>(x_rev.str + x_rev.len));
-  std::reverse(const_cast<char*>(y_rev.str),
-               const_cast<char*>(y_rev.str + y_rev.len));
-  std::reverse(const_cast<char*>(z_rev.str),
-               const_cast<char*>(z_rev.str + z_rev.len));
-
-  auto const x = utl::parse<std::uint32_t>(x_rev);
-  auto const y = utl::parse<std::uint32_t>(y_rev);
-  auto const z = utl::parse<std::uint32_t>(z_rev);
-
-  return geo::tile{y, z, x};
+  return geo::tile{x, y, z};
 }
 
 }  // namespace tiles
@@ -2,6 +2,7 @@
 
 #include <chrono>
 #include <array>
+#include <cstdint>
 #include <iostream>
 #include <numeric>
 #include <vector>
@@ -11,6 +12,7 @@ namespace tiles {
 namespace perf_task {
 enum perf_task_t : uint32_t {
   RESULT_SIZE,
+  ALLOCATIONS,
 
   GET_TILE_TOTAL,
   GET_TILE_FETCH,
@@ -125,6 +127,29 @@ scoped_perf_counter_impl<Task, PerfCounter> scoped_perf_counter(
   return scoped_perf_counter_impl<Task, PerfCounter>{pc};
 }
 
+// number of heap allocations of the calling thread so far
+// (always zero unless compiled with TILES_COUNT_ALLOCATIONS)
+uint64_t thread_allocation_count();
+
+template <typename PerfCounter>
+struct scoped_allocation_counter {
+  explicit scoped_allocation_counter(PerfCounter& pc)
+      : pc_{pc}, start_{thread_allocation_count()} {}
+  ~scoped_allocation_counter() {
+    pc_.template append<perf_task::ALLOCATIONS>(thread_allocation_count() -
+                                                start_);
+  }
+
+  scoped_allocation_counter(scoped_allocation_counter&&) = delete;
+  scoped_allocation_counter(scoped_allocation_counter const&) = delete;
+  scoped_allocation_counter& operator=(scoped_allocation_counter&&) = delete;
+  scoped_allocation_counter& operator=(scoped_allocation_counter const&) =
+      delete;
+
+  PerfCounter& pc_;
+  uint64_t start_;
+};
+
 void perf_report_get_tile(perf_counter&);
 
 }  // namespace tiles
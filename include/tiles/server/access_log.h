@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+#include <thread>
+
+#include "tiles/server/mpsc_ring.h"
+
+namespace tiles {
+
+struct access_log_entry {
+  void set_target(std::string_view);
+  std::string_view target() const { return {target_.data(), target_size_}; }
+
+  std::chrono::system_clock::time_point time_;
+  std::string_view method_;  // must point to static storage
+  std::array<char, 120> target_;  // truncated
+  uint8_t target_size_{0};
+  uint16_t status_{0};
+  uint64_t bytes_{0};
+  uint64_t total_ns_{0};
+  uint64_t render_ns_{0};  // zero: not rendered for this request
+};
+
+struct access_log_settings {
+  size_t sample_every_{1};  // log every n-th request (0 = no access log)
+  size_t max_lines_per_second_{1000};  // 0 = unlimited
+  size_t queue_size_{4096};  // power of two
+};
+
+// Access log which never blocks the caller: entries are handed to a
+// background thread through a lock-free ring, which writes them in
+// batches. Entries are dropped if they are not sampled, exceed the rate
+// limit, or the ring is full. Server errors (5xx) are never sampled out.
+struct access_logger {
+  explicit access_logger(access_log_settings, std::ostream&);
+  ~access_logger();
+
+  access_logger(access_logger const&) = delete;
+  access_logger(access_logger&&) = delete;
+  access_logger& operator=(access_logger const&) = delete;
+  access_logger& operator=(access_logger&&) = delete;
+
+  void log(access_log_entry const&);
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  bool admit(access_log_entry const&);
+  void run();
+
+  access_log_settings settings_;
+  std::ostream& out_;
+
+  std::atomic_uint64_t sample_seq_{0};
+  std::atomic_int64_t rate_window_{0};
+  std::atomic_uint64_t rate_window_count_{0};
+  std::atomic_uint64_t dropped_{0};
+
+  mpsc_ring<access_log_entry> ring_;
+  std::atomic_bool stop_{false};
+  std::thread thread_;
+};
+
+}  // namespace tiles
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace tiles {
+
+// Tiles are stored deflate compressed. Other encodings are transcoded from
+// that on demand (the server caches them, the value is part of the key).
+enum class content_encoding { deflate, gzip, identity };
+
+// name for the Content-Encoding header (empty for identity)
+std::string_view encoding_name(content_encoding);
+
+// Picks the best encoding according to the Accept-Encoding q-values.
+// Ties are broken by the transcoding cost: deflate > gzip > identity.
+// Returns nullopt if nothing is acceptable (-> 406 Not Acceptable).
+std::optional<content_encoding> negotiate_encoding(
+    std::string_view accept_encoding);
+
+// Same, but only the given encodings are available.
+std::optional<content_encoding> negotiate_encoding(
+    std::string_view accept_encoding,
+    std::initializer_list<content_encoding> available);
+
+// input: deflate compressed tile
+std::string encode_tile(content_encoding, std::string_view deflated);
+
+}  // namespace tiles
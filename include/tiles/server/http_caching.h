@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "geo/tile.h"
+
+namespace tiles {
+
+// strong validator: tiles are immutable for one build of the database
+// (each content encoding is a different representation -> variant).
+// tiles compressed on the fly are only the same bytes with the same
+// compressor settings (see make_compressor_tag).
+std::string make_tile_etag(std::string_view build_id, geo::tile const&,
+                           std::string_view variant = {},
+                           std::string_view compressor = {});
+
+// compression backend and level, e.g. "zlib9"
+std::string make_compressor_tag(int level);
+
+// If-None-Match uses the weak comparison (RFC 7232 3.2)
+bool etag_matches(std::string_view if_none_match, std::string_view etag);
+
+}  // namespace tiles
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+
+#include "utl/verify.h"
+
+namespace tiles {
+
+// Bounded lock-free queue for many producers and a single consumer
+// (sequence numbers per slot as in Dmitry Vyukov's bounded MPMC queue).
+//
+// try_push never blocks: it fails if the queue is full.
+template <typename T>
+struct mpsc_ring {
+  explicit mpsc_ring(size_t const capacity)
+      : mask_{capacity - 1}, slots_{std::make_unique<slot[]>(capacity)} {
+    utl::verify(std::has_single_bit(capacity),
+                "mpsc_ring: capacity must be a power of two");
+    for (auto i = size_t{0}; i < capacity; ++i) {
+      slots_[i].seq_.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  bool try_push(T const& value) {
+    auto pos = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      auto& s = slots_[pos & mask_];
+      auto const seq = s.seq_.load(std::memory_order_acquire);
+      auto const diff =
+          static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          s.value_ = value;
+          s.seq_.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // full
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // single consumer only
+  bool try_pop(T& value) {
+    auto& s = slots_[head_ & mask_];
+    if (s.seq_.load(std::memory_order_acquire) != head_ + 1) {
+      return false;  // empty (or the producer is not done yet)
+    }
+    value = s.value_;
+    s.seq_.store(head_ + mask_ + 1, std::memory_order_release);
+    ++head_;
+    return true;
+  }
+
+  struct slot {
+    std::atomic_size_t seq_;
+    T value_;
+  };
+
+  size_t mask_;
+  std::unique_ptr<slot[]> slots_;
+  alignas(64) std::atomic_size_t tail_{0};
+  alignas(64) size_t head_{0};
+};
+
+}  // namespace tiles
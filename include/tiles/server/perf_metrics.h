@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "tiles/perf_counter.h"
+
+namespace tiles {
+
+// Histogram with power of two buckets: bucket i counts the values with
+// std::bit_width(value) == i (i.e. value < 2^i). Written by one thread
+// only, read by everyone (relaxed atomics, no locks).
+struct perf_histogram {
+  static constexpr auto const kBucketCount = 65U;
+
+  void record(uint64_t const value) {
+    buckets_[std::bit_width(value)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  std::array<std::atomic_uint64_t, kBucketCount> buckets_{};
+  std::atomic_uint64_t sum_{0};
+};
+
+// Plain copy of (possibly many merged) perf_histograms.
+struct perf_histogram_snapshot {
+  void merge(perf_histogram const&);
+  void merge(perf_histogram_snapshot const&);
+
+  uint64_t count() const;
+
+  std::array<uint64_t, perf_histogram::kBucketCount> buckets_{};
+  uint64_t sum_{0};
+};
+
+using perf_histograms = std::array<perf_histogram, perf_task::SIZE>;
+using perf_snapshot = std::array<perf_histogram_snapshot, perf_task::SIZE>;
+
+// Latency / size histograms for every perf_task. Each thread records
+// into its own histograms, which are merged on demand.
+struct perf_metrics {
+  perf_metrics();
+
+  // histograms of the calling thread (registered on first use)
+  perf_histograms& local();
+
+  // record all samples of a (per request) perf_counter
+  void add(perf_counter const&);
+
+  perf_snapshot snapshot() const;
+
+  uint64_t id_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::pair<std::thread::id, std::unique_ptr<perf_histograms>>>
+      threads_;
+};
+
+// PerfCounter which records into the thread local histograms of a
+// perf_metrics instance instead of storing all samples.
+struct metrics_perf_counter {
+  using clock_t = perf_counter::clock_t;
+
+  explicit metrics_perf_counter(perf_metrics& metrics)
+      : histograms_{metrics.local()} {
+    running_.fill(perf_counter::kInvalidTimePoint);
+  }
+
+  template <perf_task::perf_task_t Task>
+  void append(uint64_t const value) {
+    histograms_[Task].record(value);
+  }
+
+  template <perf_task::perf_task_t Task>
+  void start() {
+    running_[Task] = clock_t::now();
+  }
+
+  template <perf_task::perf_task_t Task>
+  void stop() {
+    auto const end = clock_t::now();
+    auto const& start = running_[Task];
+
+    if (start == perf_counter::kInvalidTimePoint) {
+      return;
+    }
+
+    using namespace std::chrono;
+    histograms_[Task].record(duration_cast<nanoseconds>(end - start).count());
+    running_[Task] = perf_counter::kInvalidTimePoint;
+  }
+
+  perf_histograms& histograms_;
+  std::array<perf_counter::time_point_t, perf_task::SIZE> running_;
+};
+
+// Prometheus text format
+void append_prometheus_metrics(std::string& buf, perf_snapshot const&);
+
+}  // namespace tiles
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tiles {
+
+// Bounded executor for expensive work (i.e. tile rendering) which must not
+// block the I/O threads of the server.
+//
+// - submit fails if the queue is full (caller should answer 503)
+// - tasks are called with expired=true if their deadline passed before a
+//   worker could pick them up (or the pool shuts down before that)
+struct render_pool {
+  using clock_t = std::chrono::steady_clock;
+  using task_t = std::function<void(bool /* expired */)>;
+
+  render_pool(size_t thread_count, size_t max_queue_size);
+  ~render_pool();
+
+  render_pool(render_pool const&) = delete;
+  render_pool(render_pool&&) = delete;
+  render_pool& operator=(render_pool const&) = delete;
+  render_pool& operator=(render_pool&&) = delete;
+
+  bool submit(clock_t::time_point deadline, task_t);
+
+  size_t queue_size() const;
+
+  void run();
+
+  size_t max_queue_size_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::pair<clock_t::time_point, task_t>> queue_;
+  bool stop_{false};
+
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace tiles
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "geo/tile.h"
+
+namespace tiles {
+
+enum class endpoint : uint8_t {
+  tile,
+  batch,
+  metrics,
+  glyphs,
+  file,
+  bad_request
+};
+
+struct route {
+  endpoint endpoint_{endpoint::bad_request};
+  geo::tile tile_{};  // endpoint::tile / batch (root tile)
+  uint32_t depth_{0};  // endpoint::batch
+  std::string_view name_;  // endpoint::glyphs / file (decoded, relative)
+};
+
+// decoded paths longer than this are rejected (bad request)
+constexpr auto const kMaxUrlLength = 2048U;
+using url_buffer_t = std::array<char, kMaxUrlLength>;
+
+// Single pass over the request target without heap allocations: drops the
+// query, percent-decodes the path once into buf (name_ points into it) and
+// dispatches by prefix / suffix:
+//
+//   .../{z}/{x}/{y}.mvt           -> tile
+//   /batch/{depth}/{z}/{x}/{y}    -> batch
+//   /metrics                      -> metrics
+//   /glyphs/{name}                -> glyphs
+//   /{name}                       -> file ("/" -> index.html)
+route route_request(std::string_view target, url_buffer_t& buf);
+
+}  // namespace tiles
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "boost/asio/buffer.hpp"
+#include "boost/beast/core/error.hpp"
+#include "boost/beast/http/message.hpp"
+#include "boost/optional.hpp"
+
+namespace tiles {
+
+// Beast body type for responses which do not own their bytes.
+//
+// The body is a view plus a type-erased owner that keeps the viewed memory
+// alive until the response has been written (e.g. a cached tile, or a read
+// transaction in case the view points into the memory map of the database).
+// Static memory (embedded resources) needs no owner at all.
+struct shared_body {
+  struct value_type {
+    void assign(std::string str) {
+      assign(std::make_shared<std::string const>(std::move(str)));
+    }
+
+    void assign(std::shared_ptr<std::string const> str) {
+      view_ = *str;
+      owner_ = std::move(str);
+    }
+
+    void assign(std::string_view view, std::shared_ptr<void const> owner) {
+      view_ = view;
+      owner_ = std::move(owner);
+    }
+
+    void clear() {
+      view_ = {};
+      owner_.reset();
+    }
+
+    std::size_t size() const { return view_.size(); }
+    bool empty() const { return view_.empty(); }
+
+    std::string_view view_;
+    std::shared_ptr<void const> owner_;
+  };
+
+  static std::uint64_t size(value_type const& body) {
+    return body.view_.size();
+  }
+
+  struct writer {
+    using const_buffers_type = boost::asio::const_buffer;
+
+    template <bool IsRequest, typename Fields>
+    writer(boost::beast::http::header<IsRequest, Fields> const&,
+           value_type const& body)
+        : body_{body} {}
+
+    void init(boost::beast::error_code& ec) { ec = {}; }
+
+    boost::optional<std::pair<const_buffers_type, bool>> get(
+        boost::beast::error_code& ec) {
+      ec = {};
+      return {{const_buffers_type{body_.view_.data(), body_.view_.size()},
+               false}};
+    }
+
+    value_type const& body_;
+  };
+};
+
+}  // namespace tiles
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "utl/verify.h"
+
+namespace tiles {
+
+// Coalesces concurrent requests for the same key: only the first caller
+// (the leader) does the actual work, all others just wait for the result.
+//
+// Waiting is callback based to never block a thread:
+// - join registers a callback and returns true if the caller became leader
+// - the leader must call finish, which calls all registered callbacks
+//   (including the one of the leader) on the calling thread
+// - all callers of one key share a State (e.g. to cancel the work)
+template <typename Key, typename Value, typename State = std::monostate>
+struct single_flight {
+  using callback_t = std::function<void(Value const&)>;
+
+  struct entry {
+    std::vector<callback_t> callbacks_;
+    std::shared_ptr<State> state_{std::make_shared<State>()};
+  };
+
+  bool join(Key const& key, callback_t cb,
+            std::shared_ptr<State>* state = nullptr) {
+    std::lock_guard<std::mutex> l{mutex_};
+    auto [it, inserted] = in_flight_.try_emplace(key);
+    it->second.callbacks_.emplace_back(std::move(cb));
+    if (state != nullptr) {
+      *state = it->second.state_;
+    }
+    return inserted;
+  }
+
+  void finish(Key const& key, Value const& value) {
+    std::vector<callback_t> callbacks;
+    {
+      std::lock_guard<std::mutex> l{mutex_};
+      auto it = in_flight_.find(key);
+      utl::verify(it != end(in_flight_), "single_flight: unknown key");
+      callbacks = std::move(it->second.callbacks_);
+      in_flight_.erase(it);
+    }
+
+    for (auto const& cb : callbacks) {
+      cb(value);
+    }
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> l{mutex_};
+    return in_flight_.size();
+  }
+
+  mutable std::mutex mutex_;
+  std::unordered_map<Key, entry> in_flight_;
+};
+
+}  // namespace tiles
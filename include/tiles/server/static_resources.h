@@ -0,0 +1,73 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace tiles {
+
+// A file served as is. Everything is computed once: the responses only
+// point into this struct (which must outlive them).
+struct static_resource {
+  std::string_view content_type_;
+  std::string etag_;  // strong validator: hash of the content
+  std::string gzip_etag_;
+  std::string_view identity_;
+  std::string gzip_;  // empty: not compressible (enough)
+  std::string storage_;  // owns identity_ unless it is static memory
+};
+
+// content type / whether gzip is worth trying, by file extension
+std::string_view guess_content_type(std::string_view name);
+bool is_compressible(std::string_view content_type);
+
+// content: static memory or moved into the resource (owned = true)
+std::unique_ptr<static_resource> make_static_resource(std::string_view name,
+                                                      std::string content);
+std::unique_ptr<static_resource> make_static_resource(
+    std::string_view name, std::string_view static_content);
+
+// Table of static files by (relative) name.
+//
+// The files of a directory are read into memory up front. Embedded
+// resources (static memory, but no way to enumerate them) are looked up
+// through the fallback on first use and kept afterwards.
+struct static_resources {
+  using fallback_fn_t =
+      std::function<std::optional<std::string_view>(std::string const&)>;
+
+  explicit static_resources(fallback_fn_t fallback = nullptr)
+      : fallback_{std::move(fallback)} {}
+
+  void add_directory(std::filesystem::path const&);
+
+  static_resource const* find(std::string_view name);
+
+  size_t size() const { return files_.size(); }
+
+private:
+  struct string_hash {
+    using is_transparent = void;
+    size_t operator()(std::string_view const s) const {
+      return std::hash<std::string_view>{}(s);
+    }
+  };
+
+  // lookups by string_view without allocations
+  using map_t =
+      std::unordered_map<std::string, std::unique_ptr<static_resource>,
+                         string_hash, std::equal_to<>>;
+
+  map_t files_;  // immutable after startup
+
+  fallback_fn_t fallback_;
+  std::shared_mutex fallback_mutex_;
+  map_t fallback_files_;
+};
+
+}  // namespace tiles
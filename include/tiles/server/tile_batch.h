@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "geo/tile.h"
+
+namespace tiles {
+
+// 2^3 x 2^3 = 64 tiles per batch at most
+constexpr auto const kMaxBatchDepth = 3U;
+
+// all tiles depth levels below root (row major)
+std::vector<geo::tile> batch_tiles(geo::tile const& root, unsigned depth);
+
+// Batch responses are a sequence of frames, one per tile:
+//
+//   uint32 z, uint32 x, uint32 y, uint32 size (little endian), size bytes
+//
+// The tile data is stored as is (deflate compressed), size 0 means the
+// tile is empty.
+void append_tile_frame(std::string& buf, geo::tile const&,
+                       std::string_view data);
+
+std::vector<std::pair<geo::tile, std::string_view>> parse_tile_frames(
+    std::string_view buf);
+
+}  // namespace tiles
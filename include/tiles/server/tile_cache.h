@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tiles/db/tile_index.h"
+
+namespace tiles {
+
+// Byte-bounded cache for rendered (i.e. already compressed) tiles.
+//
+// - keys are tile_to_key(tile, n) values (server: n = content encoding),
+//   entries are immutable and shared
+// - sharded by key to keep lock contention low for concurrent requests
+// - eviction follows the CLOCK (second chance) policy per shard
+// - an empty string is a valid value (= tile without content)
+struct tile_cache {
+  using value_t = std::shared_ptr<std::string const>;
+
+  // rough per entry overhead (slot, index node, shared_ptr control block)
+  static constexpr auto const kEntryOverhead = size_t{96};
+
+  struct stats {
+    uint64_t hits_{0}, misses_{0}, inserts_{0}, evictions_{0};
+    uint64_t entries_{0}, bytes_{0};
+  };
+
+  explicit tile_cache(size_t max_bytes, size_t shard_count = 64);
+  ~tile_cache();
+
+  tile_cache(tile_cache const&) = delete;
+  tile_cache(tile_cache&&) = delete;
+  tile_cache& operator=(tile_cache const&) = delete;
+  tile_cache& operator=(tile_cache&&) = delete;
+
+  value_t get(tile_key_t);
+  void put(tile_key_t, value_t);
+
+  stats get_stats() const;
+
+  struct shard;
+  shard& get_shard(tile_key_t);
+
+  size_t max_bytes_;
+  std::vector<std::unique_ptr<shard>> shards_;
+
+  std::atomic_uint64_t hits_{0}, misses_{0}, inserts_{0}, evictions_{0};
+};
+
+}  // namespace tiles
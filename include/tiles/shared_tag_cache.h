@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace tiles {
+
+// Layer local tag (key and value index) of shared metadata by shared id.
+//
+// The shared ids are dense: a flat array indexed by id instead of hashing
+// the strings. Entries are invalidated with a generation counter, so
+// clear() is O(1) and a reused cache stops allocating.
+struct shared_tag_cache {
+  struct tag {
+    friend bool operator==(tag const&, tag const&) = default;
+
+    uint32_t key_, value_;
+  };
+
+  // for metadata which is not written at all
+  static constexpr auto const kSkip = tag{std::numeric_limits<uint32_t>::max(),
+                                          std::numeric_limits<uint32_t>::max()};
+
+  // create() -> tag is only called on the first lookup of an id
+  template <typename Fn>
+  tag get_or_create(uint64_t const id, Fn&& create) {
+    if (id >= entries_.size()) {
+      entries_.resize(std::max(static_cast<size_t>(id + 1),
+                               entries_.size() * 2));
+    }
+
+    auto& e = entries_[id];
+    if (e.generation_ != generation_) {
+      e.tag_ = create();
+      e.generation_ = generation_;
+    }
+    return e.tag_;
+  }
+
+  void clear() {
+    if (++generation_ == 0) {  // wrapped: old generations would be valid
+      std::fill(begin(entries_), end(entries_), entry{});
+      generation_ = 1;
+    }
+  }
+
+private:
+  struct entry {
+    uint32_t generation_{0};
+    tag tag_{};
+  };
+
+  std::vector<entry> entries_;
+  uint32_t generation_{1};
+};
+
+}  // namespace tiles
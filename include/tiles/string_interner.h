@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tiles {
+
+// Assigns consecutive indices to distinct strings (e.g. the keys and values
+// of a vector tile layer).
+//
+// All strings live in one buffer and the lookup table is open addressing,
+// so clear() keeps the memory and a reused interner stops allocating.
+struct string_interner {
+  size_t get_or_create(std::string_view const str) {
+    if ((entries_.size() + 1) * 2 > slots_.size()) {
+      grow();
+    }
+
+    auto const mask = slots_.size() - 1;
+    for (auto i = hash(str) & mask;; i = (i + 1) & mask) {
+      if (slots_[i] == 0) {
+        slots_[i] = static_cast<uint32_t>(entries_.size() + 1);
+        entries_.emplace_back(data_.size(), str.size());
+        data_.append(str);
+        return entries_.size() - 1;
+      } else if (at(slots_[i] - 1) == str) {
+        return slots_[i] - 1;
+      }
+    }
+  }
+
+  std::string_view at(size_t const idx) const {
+    auto const [offset, size] = entries_[idx];
+    return std::string_view{data_}.substr(offset, size);
+  }
+
+  size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+
+  void clear() {
+    if (!entries_.empty()) {
+      std::fill(begin(slots_), end(slots_), 0);
+    }
+    entries_.clear();
+    data_.clear();
+  }
+
+private:
+  static size_t hash(std::string_view const str) {
+    return std::hash<std::string_view>{}(str);
+  }
+
+  void grow() {
+    slots_.assign(slots_.empty() ? 64 : slots_.size() * 2, 0);
+    auto const mask = slots_.size() - 1;
+    for (auto idx = 0U; idx < entries_.size(); ++idx) {
+      auto i = hash(at(idx)) & mask;
+      while (slots_[i] != 0) {
+        i = (i + 1) & mask;
+      }
+      slots_[i] = idx + 1;
+    }
+  }
+
+  std::string data_;
+  std::vector<std::pair<size_t, size_t>> entries_;  // offset, size
+  std::vector<uint32_t> slots_;  // entry index + 1, 0 = empty
+};
+
+}  // namespace tiles
@@ -9,6 +9,7 @@
 #include <iostream>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "fmt/core.h"
@@ -33,7 +34,25 @@ inline void t_log(fmt::format_string<Args...> fmt_str, Args&&... args) {
   std::clog << std::endl;
 }
 
-std::string compress_deflate(std::string const&);
+// compression levels depend on the backend (zlib: 0-9, libdeflate: 0-12)
+#ifdef TILES_LIBDEFLATE
+constexpr auto kMaxCompressionLevel = 12;
+#else
+constexpr auto kMaxCompressionLevel = 9;
+#endif
+constexpr auto kDefaultCompressionLevel = 9;
+
+char const* compression_backend();
+
+// output: zlib stream
+std::string compress_deflate(std::string const&,
+                             int level = kDefaultCompressionLevel);
+
+// input: zlib stream (as produced by compress_deflate)
+std::string decompress_deflate(std::string_view);
+
+// rewraps the raw deflate data of a zlib stream into a gzip member
+std::string deflate_to_gzip(std::string_view);
 
 struct progress_tracker {
 #ifdef TILES_GLOBAL_PROGRESS_TRACKER
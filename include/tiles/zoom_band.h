@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tiles {
+
+// a setting for all zoom levels in [min_z_, max_z_]
+struct zoom_band {
+  uint32_t min_z_, max_z_;
+  int value_;
+};
+
+// format: "<min_z>-<max_z>:<value>" or "<z>:<value>"
+// values outside [min_value, max_value] are rejected
+std::vector<zoom_band> parse_zoom_bands(
+    std::vector<std::string> const&,
+    int min_value = std::numeric_limits<int>::min(),
+    int max_value = std::numeric_limits<int>::max());
+
+// first matching band wins
+std::optional<int> get_zoom_band_value(std::vector<zoom_band> const&,
+                                       uint32_t z);
+
+}  // namespace tiles
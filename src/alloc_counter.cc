@@ -0,0 +1,48 @@
+#include "tiles/perf_counter.h"
+
+#ifdef TILES_COUNT_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+thread_local uint64_t allocation_count = 0;
+}  // namespace
+
+// counts all allocations: array and nothrow variants forward to these
+void* operator new(std::size_t const size) {
+  ++allocation_count;
+  if (auto* const ptr = std::malloc(size == 0 ? 1 : size); ptr != nullptr) {
+    return ptr;
+  }
+  throw std::bad_alloc{};
+}
+
+void* operator new(std::size_t const size, std::align_val_t const align) {
+  ++allocation_count;
+  auto const a = static_cast<std::size_t>(align);
+  auto const rounded = ((size == 0 ? 1 : size) + a - 1) / a * a;
+  if (auto* const ptr = std::aligned_alloc(a, rounded); ptr != nullptr) {
+    return ptr;
+  }
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+namespace tiles {
+uint64_t thread_allocation_count() { return allocation_count; }
+}  // namespace tiles
+
+#else
+
+namespace tiles {
+uint64_t thread_allocation_count() { return 0; }
+}  // namespace tiles
+
+#endif
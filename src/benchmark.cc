@@ -1,5 +1,6 @@
 #include <cstdlib>
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <random>
 
@@ -12,6 +13,8 @@
 #include "tiles/db/tile_database.h"
 #include "tiles/get_tile.h"
 #include "tiles/perf_counter.h"
+#include "tiles/util.h"
+#include "tiles/zoom_band.h"
 
 namespace tiles {
 
@@ -22,13 +25,72 @@ struct benchmark_settings : public conf::configuration {
           "xyz coords of a single tile, z for all tiles on a certain zoom "
           "level, if not present random smaple");
     param(compress_, "compress", "compress the tiles");
+    param(compression_level_, "compression_level",
+          "deflate level per zoom band: '<min_z>-<max_z>:<level>' or "
+          "'<z>:<level>', first match wins");
+    param(compression_benchmark_, "compression_benchmark",
+          "report compression time and ratio for every level (sample only)");
   }
 
   std::string db_fname_{"tiles.mdb"};
   std::vector<uint32_t> tile_;
   bool compress_{true};
+  std::vector<std::string> compression_level_;
+  bool compression_benchmark_{false};
 };
 
+template <typename Tiles>
+void run_compression_benchmark(tile_db_handle& db_handle,
+                               pack_handle const& pack_handle,
+                               render_ctx ctx, Tiles const& tiles) {
+  ctx.compress_result_ = false;
+
+  std::vector<std::string> rendered;
+  {
+    auto txn = db_handle.make_txn();
+    auto features_dbi = db_handle.features_dbi(txn);
+    auto features_cursor = lmdb::cursor{txn, features_dbi};
+
+    null_perf_counter pc;
+    for (auto const& tile : tiles) {
+      if (auto t = get_tile(db_handle, txn, features_cursor, pack_handle, ctx,
+                            tile, pc);
+          t) {
+        rendered.emplace_back(std::move(*t));
+      }
+    }
+  }
+
+  auto raw_size = size_t{0};
+  for (auto const& t : rendered) {
+    raw_size += t.size();
+  }
+  fmt::print(std::cout, "{} tiles with content, {} uncompressed [{}]\n",
+             rendered.size(), printable_bytes{raw_size},
+             compression_backend());
+  if (rendered.empty()) {
+    return;
+  }
+
+  for (auto level = 0; level <= kMaxCompressionLevel; ++level) {
+    auto compressed_size = size_t{0};
+    auto const start = std::chrono::steady_clock::now();
+    for (auto const& t : rendered) {
+      compressed_size += compress_deflate(t, level).size();
+    }
+    auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+
+    fmt::print(std::cout,
+               "level {:>2} | total {} | per tile {} | size {} | "
+               "ratio {:.3f}\n",
+               level, printable_ns{ns}, printable_ns{ns / rendered.size()},
+               printable_bytes{compressed_size},
+               static_cast<double>(compressed_size) / raw_size);
+  }
+}
+
 int run_tiles_benchmark(int argc, char const** argv) {
   benchmark_settings opt;
 
@@ -56,8 +118,20 @@ int run_tiles_benchmark(int argc, char const** argv) {
   auto render_ctx = make_render_ctx(db_handle);
   render_ctx.ignore_prepared_ = true;
   render_ctx.compress_result_ = opt.compress_;
+  render_ctx.compression_levels_ =
+      parse_zoom_bands(opt.compression_level_, 0, kMaxCompressionLevel);
+  prepare_seaside_tile_blobs(render_ctx);
 
-  if (opt.tile_.empty()) {
+  if (opt.compression_benchmark_) {
+    geo::latlng const p1{49.83, 8.55};
+    geo::latlng const p2{50.13, 8.74};
+
+    for (auto z = 9; z < 18; z += 2) {
+      fmt::print(std::cout, "=== compress z {}\n", z);
+      run_compression_benchmark(db_handle, pack_handle, render_ctx,
+                                geo::make_tile_range(p1, p2, z));
+    }
+  } else if (opt.tile_.empty()) {
     geo::latlng const p1{49.83, 8.55};
     geo::latlng const p2{50.13, 8.74};
 
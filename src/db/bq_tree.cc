@@ -99,6 +99,12 @@ bool bq_tree::contains(geo::tile const& q) const {
   return decision.has_value() ? *decision : false;
 }
 
+bool bq_tree::intersects(geo::tile const& q) const {
+  // inner nodes only exist above TRUE leafs
+  auto const decision = find_parent_leaf(q).first;
+  return decision.has_value() ? *decision : true;
+}
+
 std::vector<geo::tile> bq_tree::all_leafs(geo::tile const& q) const {
   auto const parent = find_parent_leaf(q);
   auto const& decision = parent.first;
@@ -59,10 +59,15 @@ void database_stats(tile_db_handle& db_handle, pack_handle& pack_handle) {
   print_stat(" dbi:features", features_dbi.stat());
   print_stat(" dbi:tiles", tiles_dbi.stat());
   print_stat(" dbi:meta", meta_dbi.stat());
+  fmt::print(std::cout, "feature key layout: {}\n",
+             db_handle.feature_key_layout_ == tile_key_layout::morton
+                 ? "morton"
+                 : "row major");
   std::cout << "\n";
 
   std::vector<size_t> pack_sizes;
   std::vector<size_t> index_sizes;
+  std::vector<size_t> column_sizes;
   std::vector<size_t> header_sizes;
   std::vector<size_t> simplify_mask_sizes;
   std::vector<size_t> geometry_sizes;
@@ -97,14 +102,24 @@ void database_stats(tile_db_handle& db_handle, pack_handle& pack_handle) {
             }
           });
 
+      // v3: the header is the (exact) skip index entry, without the offset
+      auto const columns = feature_columns::find(pack);
+      if (columns) {
+        header_sizes.insert(end(header_sizes), columns->size(),
+                            feature_skip_index::kEntrySize - 4ULL);
+        column_sizes.push_back(columns->byte_size());
+      }
+
       pack_sizes.push_back(pack.size());
-      index_sizes.push_back(pack.size() - feature_end_offset);
+      index_sizes.push_back(pack.size() - feature_end_offset -
+                            (columns ? columns->byte_size() : 0ULL));
     });
   }
 
   std::cout << ">> payload stats:\n";
   print_sizes("pack", pack_sizes);
   print_sizes("pack: index", index_sizes);
+  print_sizes("pack: columns", column_sizes);
   print_sizes("feature: header", header_sizes);
   print_sizes("feature: masks", simplify_mask_sizes);
   print_sizes("feature: geo", geometry_sizes);
@@ -36,6 +36,62 @@ void feature_packer::finish() {
   tiles::append<uint32_t>(buf_, crc32.checksum());
 }
 
+uint32_t feature_packer::append_skip_index(
+    std::vector<skip_entry> const& entries) {
+  utl::verify(entries.size() <= std::numeric_limits<uint32_t>::max(),
+              "packer.append_skip_index: too many entries");
+  auto const offset = static_cast<uint32_t>(buf_.size());
+  tiles::append<uint32_t>(buf_, static_cast<uint32_t>(entries.size()));
+
+  auto const column = [&](auto&& get) {
+    for (auto const& e : entries) {
+      tiles::append(buf_, get(e));
+    }
+  };
+  column([](auto const& e) { return e.offset_; });
+  column([](auto const& e) { return e.min_z_; });
+  column([](auto const& e) { return e.max_z_; });
+  column([](auto const& e) { return e.min_x_; });
+  column([](auto const& e) { return e.min_y_; });
+  column([](auto const& e) { return e.max_x_; });
+  column([](auto const& e) { return e.max_y_; });
+  return offset;
+}
+
+uint32_t feature_packer::append_columns(
+    std::vector<column_entry> const& entries) {
+  utl::verify(entries.size() <= std::numeric_limits<uint32_t>::max(),
+              "packer.append_columns: too many entries");
+  while (buf_.size() % 8 != 0) {
+    tiles::append<uint8_t>(buf_, 0U);
+  }
+
+  auto const offset = static_cast<uint32_t>(buf_.size());
+  tiles::append<uint32_t>(buf_, static_cast<uint32_t>(entries.size()));
+  tiles::append<uint32_t>(buf_, 0U);
+
+  for (auto const& e : entries) {
+    tiles::append<uint64_t>(buf_, e.id_);
+  }
+  for (auto const& e : entries) {
+    tiles::append<uint32_t>(buf_, e.layer_);
+  }
+
+  auto meta_offset = size_t{0};
+  for (auto const& e : entries) {
+    tiles::append<uint32_t>(buf_, static_cast<uint32_t>(meta_offset));
+    meta_offset += e.meta_.size();
+    utl::verify(meta_offset <= std::numeric_limits<uint32_t>::max(),
+                "packer.append_columns: too much metadata");
+  }
+  tiles::append<uint32_t>(buf_, static_cast<uint32_t>(meta_offset));
+
+  for (auto const& e : entries) {
+    buf_.append(e.meta_);
+  }
+  return offset;
+}
+
 bool feature_pack_valid(std::string_view const sv) {
   if (sv.size() < sizeof(uint32_t)) {
     return false;
@@ -56,18 +112,30 @@ std::string pack_features(std::vector<std::string> const& serialized_features) {
 
 std::string pack_features(geo::tile const& tile,
                           shared_metadata_coder const& metadata_coder,
-                          std::vector<std::string> const& packs) {
+                          std::vector<std::string> const& packs,
+                          feature_pack_format const format) {
+  if (format == feature_pack_format::v3) {
+    // v3 headers live in the skip index: fall back to v2 if it is lossy
+    columnar_feature_packer p{tile, metadata_coder};
+    p.pack_features(packs);
+    if (p.exact_skip_entries_) {
+      p.finish();
+      return std::move(p.packer_.buf_);
+    }
+  }
+
   quadtree_feature_packer p{tile, metadata_coder};
   p.pack_features(packs);
   p.finish();
-  return p.packer_.buf_;
+  return std::move(p.packer_.buf_);
 }
 
-void pack_features(tile_db_handle& db_handle, pack_handle& pack_handle) {
+void pack_features(tile_db_handle& db_handle, pack_handle& pack_handle,
+                   feature_pack_format const format) {
   auto const metadata_coder = make_shared_metadata_coder(db_handle);
   pack_features(db_handle, pack_handle,
                 [&](auto const tile, auto const& packs) {
-                  return pack_features(tile, metadata_coder, packs);
+                  return pack_features(tile, metadata_coder, packs, format);
                 });
 }
 
@@ -75,6 +143,8 @@ void pack_features(
     tile_db_handle& db_handle, pack_handle& pack_handle,
     std::function<std::string(geo::tile, std::vector<std::string> const&)>
         pack_fn) {
+  auto const layout = db_handle.feature_key_layout_;
+
   std::vector<tile_record> tasks;
   {
     auto txn = db_handle.make_txn();
@@ -83,7 +153,7 @@ void pack_features(
 
     for (auto el = c.get<tile_key_t>(lmdb::cursor_op::FIRST); el;
          el = c.get<tile_key_t>(lmdb::cursor_op::NEXT)) {
-      auto tile = key_to_tile(el->first);
+      auto tile = key_to_tile(layout, el->first);
       auto records = pack_records_deserialize(el->second);
       utl::verify(!records.empty(), "pack_features: empty pack_records");
 
@@ -107,7 +177,8 @@ void pack_features(
                                  auto txn = db_handle.make_txn();
                                  auto feature_dbi = db_handle.features_dbi(txn);
                                  for (auto const& [tile, records] : updates) {
-                                   txn.put(feature_dbi, tile_to_key(tile),
+                                   txn.put(feature_dbi,
+                                           tile_to_key(layout, tile),
                                            pack_records_serialize(records));
                                  }
                                  txn.commit();
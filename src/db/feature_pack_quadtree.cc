@@ -1,10 +1,13 @@
 #include "tiles/db/feature_pack_quadtree.h"
 
+#include "protozero/pbf_builder.hpp"
+
 #include "utl/equal_ranges.h"
 #include "utl/to_vec.h"
 
 #include "tiles/feature/deserialize.h"
 #include "tiles/feature/serialize.h"
+#include "tiles/fixed/algo/bounding_box.h"
 #include "tiles/mvt/tile_spec.h"
 
 namespace tiles {
@@ -16,8 +19,14 @@ void quadtree_feature_packer::pack_features(
 
   uint32_t feature_count = 0;
   for (auto const& pack : packs) {
+    auto const columns = feature_columns::find(pack);  // repacking v3
+    auto feature_idx = 0U;
     unpack_features(pack, [&](auto const& str) {
-      auto const feature = deserialize_feature(str, metadata_coder_);
+      auto const feature =
+          columns ? deserialize_feature(
+                        columnar_feature{&*columns, feature_idx++, str},
+                        metadata_coder_)
+                  : deserialize_feature(str, metadata_coder_);
       utl::verify(feature.has_value(), "feature must be valid (!?)");
 
       auto const best_tile = find_best_tile(*feature);
@@ -49,6 +58,9 @@ void quadtree_feature_packer::pack_features(
     quad_trees.emplace_back(make_quad_tree(root_, quad_tree_input));
   }
 
+  packer_.update_segment_offset(kFeatureSkipIndexId,
+                                packer_.append_skip_index(skip_entries_));
+
   // var : one quad tree per level
   // var : index array of offsets of the quad trees
   // the segment offset points to the begin of the index array
@@ -109,6 +121,7 @@ uint32_t quadtree_feature_packer::serialize_and_append_span(
     quadtree_feature_it begin, quadtree_feature_it end) {
   auto const offset = packer_.buf_.size();
   for (auto it = begin; it != end; ++it) {
+    add_skip_entry(static_cast<uint32_t>(packer_.buf_.size()), it->feature_);
     packer_.append_feature(
         serialize_feature(it->feature_, metadata_coder_, false));
   }
@@ -116,6 +129,66 @@ uint32_t quadtree_feature_packer::serialize_and_append_span(
   return static_cast<std::uint32_t>(offset);
 }
 
+void quadtree_feature_packer::add_skip_entry(uint32_t const offset,
+                                             feature const& f) {
+  using q = feature_skip_query;
+  auto const box = bounding_box(f.geometry_);
+  auto const valid = box.min_corner().x() <= box.max_corner().x() &&
+                     box.min_corner().y() <= box.max_corner().y();
+
+  auto const fits = [](auto const v, auto const max) {
+    return v >= 0 && static_cast<uint64_t>(v) <= max;
+  };
+  exact_skip_entries_ =
+      exact_skip_entries_ && valid &&
+      fits(f.zoom_levels_.first, std::numeric_limits<uint8_t>::max()) &&
+      fits(f.zoom_levels_.second, std::numeric_limits<uint8_t>::max()) &&
+      fits(box.min_corner().x(), std::numeric_limits<uint32_t>::max()) &&
+      fits(box.min_corner().y(), std::numeric_limits<uint32_t>::max()) &&
+      fits(box.max_corner().x(), std::numeric_limits<uint32_t>::max()) &&
+      fits(box.max_corner().y(), std::numeric_limits<uint32_t>::max());
+
+  // clamping keeps the entry conservative, broken boxes are never skipped
+  skip_entries_.push_back(
+      {offset, q::clamp<uint8_t>(f.zoom_levels_.first),
+       q::clamp<uint8_t>(f.zoom_levels_.second),
+       valid ? q::clamp<uint32_t>(box.min_corner().x()) : 0U,
+       valid ? q::clamp<uint32_t>(box.min_corner().y()) : 0U,
+       valid ? q::clamp<uint32_t>(box.max_corner().x())
+             : std::numeric_limits<uint32_t>::max(),
+       valid ? q::clamp<uint32_t>(box.max_corner().y())
+             : std::numeric_limits<uint32_t>::max()});
+}
+
 void quadtree_feature_packer::finish() { packer_.finish(); }
 
+uint32_t columnar_feature_packer::serialize_and_append_span(
+    quadtree_feature_it begin, quadtree_feature_it end) {
+  auto const offset = packer_.buf_.size();
+  for (auto it = begin; it != end; ++it) {
+    auto const& f = it->feature_;
+    add_skip_entry(static_cast<uint32_t>(packer_.buf_.size()), f);
+
+    utl::verify(f.layer_ <= std::numeric_limits<uint32_t>::max(),
+                "columnar_feature_packer: invalid layer");
+    auto& entry = column_entries_.emplace_back(feature_packer::column_entry{
+        f.id_, static_cast<uint32_t>(f.layer_), {}});
+    protozero::pbf_builder<tags::feature> meta_pb{entry.meta_};
+    serialize_metadata(meta_pb, f, metadata_coder_, false);
+
+    std::string geometry;
+    protozero::pbf_builder<tags::feature> geometry_pb{geometry};
+    serialize_geometry(geometry_pb, f, false);
+    packer_.append_feature_string(geometry);
+  }
+  packer_.append_span_end();
+  return static_cast<std::uint32_t>(offset);
+}
+
+void columnar_feature_packer::finish() {
+  packer_.update_segment_offset(kFeatureColumnsId,
+                                packer_.append_columns(column_entries_));
+  quadtree_feature_packer::finish();
+}
+
 }  // namespace tiles
@@ -115,7 +115,7 @@ prepare_manager make_prepare_manager(tile_db_handle& db_handle,
   auto c = lmdb::cursor{txn, feature_dbi};
   for (auto el = c.get<tile_key_t>(lmdb::cursor_op::FIRST); el;
        el = c.get<tile_key_t>(lmdb::cursor_op::NEXT)) {
-    auto const tile = key_to_tile(el->first);
+    auto const tile = key_to_tile(db_handle.feature_key_layout_, el->first);
     minx = std::min(minx, tile.x_);
     miny = std::min(miny, tile.y_);
     maxx = std::max(maxx, tile.x_);
@@ -139,6 +139,7 @@ void prepare_tiles(tile_db_handle& db_handle, pack_handle& pack_handle,
   render_ctx.ignore_fully_seaside_ = true;
   render_ctx.tb_aggregate_lines_ = true;
   render_ctx.tb_aggregate_polygons_ = true;
+  prepare_seaside_tile_blobs(render_ctx);
   null_perf_counter npc;
 
   std::vector<std::thread> threads;
@@ -157,9 +158,9 @@ void prepare_tiles(tile_db_handle& db_handle, pack_handle& pack_handle,
           auto c = lmdb::cursor{txn, feature_dbi};
 
           for (auto& task : batch) {
-            pack_records_foreach(c, task.tile_, [&](auto t, auto r) {
-              task.packs_.emplace_back(t, r);
-            });
+            pack_records_foreach(
+                db_handle.feature_key_layout_, c, task.tile_,
+                [&](auto t, auto r) { task.packs_.emplace_back(t, r); });
           }
         }
 
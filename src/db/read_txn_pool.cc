@@ -0,0 +1,79 @@
+#include "tiles/db/read_txn_pool.h"
+
+#include "utl/verify.h"
+
+namespace tiles {
+
+read_txn::read_txn(tile_db_handle& handle)
+    : txn_{handle.env_, lmdb::txn_flags::RDONLY},
+      features_cursor_{txn_, handle.features_dbi(txn_)} {}
+
+void read_txn::renew() {
+  auto const txn_rc = mdb_txn_renew(txn_.txn_);
+  utl::verify(txn_rc == MDB_SUCCESS, "mdb_txn_renew: {}",
+              mdb_strerror(txn_rc));
+
+  auto const cursor_rc =
+      mdb_cursor_renew(txn_.txn_, features_cursor_.cursor_);
+  utl::verify(cursor_rc == MDB_SUCCESS, "mdb_cursor_renew: {}",
+              mdb_strerror(cursor_rc));
+}
+
+void read_txn::reset() { mdb_txn_reset(txn_.txn_); }
+
+std::shared_ptr<read_txn> read_txn_pool::acquire() {
+  std::unique_lock<std::mutex> l{mutex_};
+  released_.wait(l, [&] { return in_use_ < max_size_; });
+  return take(l);
+}
+
+std::shared_ptr<read_txn> read_txn_pool::try_acquire(size_t const keep_free) {
+  std::unique_lock<std::mutex> l{mutex_};
+  if (in_use_ + keep_free >= max_size_) {
+    return nullptr;
+  }
+  return take(l);
+}
+
+size_t read_txn_pool::in_use() const {
+  std::lock_guard<std::mutex> l{mutex_};
+  return in_use_;
+}
+
+std::shared_ptr<read_txn> read_txn_pool::take(
+    std::unique_lock<std::mutex>& l) {
+  ++in_use_;
+  auto txn = std::unique_ptr<read_txn>{};
+  if (!free_.empty()) {
+    txn = std::move(free_.back());
+    free_.pop_back();
+  }
+  l.unlock();
+
+  try {
+    if (txn == nullptr) {
+      txn = std::make_unique<read_txn>(handle_);  // fresh txn: already active
+    } else {
+      txn->renew();
+    }
+  } catch (...) {
+    l.lock();
+    --in_use_;
+    l.unlock();
+    released_.notify_one();
+    throw;
+  }
+
+  return {txn.release(), [this](read_txn* ptr) {
+            auto released = std::unique_ptr<read_txn>{ptr};
+            released->reset();
+            {
+              std::lock_guard<std::mutex> l{mutex_};
+              free_.emplace_back(std::move(released));
+              --in_use_;
+            }
+            released_.notify_one();
+          }};
+}
+
+}  // namespace tiles
@@ -3,13 +3,13 @@
 #include <stack>
 
 #include "utl/concat.h"
-#include "utl/equal_ranges_linear.h"
 #include "utl/erase_duplicates.h"
 #include "utl/erase_if.h"
 #include "utl/to_vec.h"
 #include "utl/verify.h"
 
 #include "tiles/feature/feature.h"
+#include "tiles/feature/sort_by_metadata.h"
 #include "tiles/fixed/algo/simplify.h"
 #include "tiles/fixed/convert.h"
 #include "tiles/util.h"
@@ -251,31 +251,30 @@ fixed_polyline aggregate_geometry(std::vector<line_handle> lines) {
 
 std::vector<feature> aggregate_line_features(std::vector<feature> features,
                                              uint32_t const z) {
-  std::sort(
-      begin(features), end(features), [](auto const& lhs, auto const& rhs) {
-        return std::tie(lhs.meta_, lhs.id_) < std::tie(rhs.meta_, rhs.id_);
-      });
+  auto const runs = sort_by_metadata(features);
 
   std::vector<feature> result;
-  utl::equal_ranges_linear(
-      features,
-      [](auto const& lhs, auto const& rhs) { return lhs.meta_ == rhs.meta_; },
-      [&](auto lb, auto ub) {
-        auto lines = make_line_handles(lb, ub);
-        join_lines(lines);
-
-        feature f;
-        f.id_ = lb->id_;
-        f.meta_ = std::move(lb->meta_);
-
-        f.geometry_ = aggregate_geometry(std::move(lines));
-        if (z <= kMaxZoomLevel) {
-          f.geometry_ =
-              simplify(std::move(f.geometry_), 1ULL << (kMaxZoomLevel - z));
-        }
+  auto lb = begin(features);
+  for (auto const run : runs) {
+    auto const ub = std::next(lb, static_cast<std::ptrdiff_t>(run));
+    auto lines = make_line_handles(lb, ub);
+    join_lines(lines);
+
+    feature f;
+    f.id_ = lb->id_;
+    f.meta_ = std::move(lb->meta_);
+    f.packed_meta_ = lb->packed_meta_;
+
+    f.geometry_ = aggregate_geometry(std::move(lines));
+    if (z <= kMaxZoomLevel) {
+      f.geometry_ =
+          simplify(std::move(f.geometry_), 1ULL << (kMaxZoomLevel - z));
+    }
 
-        result.emplace_back((f));
-      });
+    result.emplace_back((f));
+
+    lb = ub;
+  }
 
   return result;
 }
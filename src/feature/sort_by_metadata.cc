@@ -0,0 +1,63 @@
+#include "tiles/feature/sort_by_metadata.h"
+
+#include <algorithm>
+#include <numeric>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+#include "utl/to_vec.h"
+
+#include "tiles/feature/deserialize.h"
+#include "tiles/feature/feature.h"
+
+namespace tiles {
+
+std::vector<size_t> sort_by_metadata(std::vector<feature>& features) {
+  // all decoded (key, value) pairs in one buffer, views into the features
+  // and their decoders: the features are only moved once the runs are known
+  using kv_t = std::pair<std::string_view, std::string_view>;
+  std::vector<kv_t> pairs;
+  std::vector<size_t> offsets;
+  offsets.reserve(features.size() + 1);
+  for (auto const& f : features) {
+    offsets.push_back(pairs.size());
+    for_each_metadata(f, [&](auto const key, auto const value) {
+      pairs.emplace_back(key, value);
+    });
+  }
+  offsets.push_back(pairs.size());
+
+  auto const meta_begin = [&](size_t const i) {
+    return std::next(begin(pairs), static_cast<std::ptrdiff_t>(offsets[i]));
+  };
+  auto const meta_end = [&](size_t const i) { return meta_begin(i + 1); };
+
+  // same order as std::tie(meta_, id_) of eagerly decoded features
+  std::vector<size_t> order(features.size());
+  std::iota(begin(order), end(order), size_t{0});
+  std::sort(begin(order), end(order), [&](size_t const a, size_t const b) {
+    auto const [a_it, b_it] =
+        std::mismatch(meta_begin(a), meta_end(a), meta_begin(b), meta_end(b));
+    if (a_it == meta_end(a) && b_it == meta_end(b)) {
+      return std::tie(features[a].id_, a) < std::tie(features[b].id_, b);
+    }
+    return b_it != meta_end(b) && (a_it == meta_end(a) || *a_it < *b_it);
+  });
+
+  std::vector<size_t> runs;
+  for (auto i = 0U; i < order.size(); ++i) {
+    if (i == 0 || !std::equal(meta_begin(order[i]), meta_end(order[i]),
+                              meta_begin(order[i - 1]),
+                              meta_end(order[i - 1]))) {
+      runs.emplace_back(0);
+    }
+    ++runs.back();
+  }
+
+  features = utl::to_vec(
+      order, [&](size_t const i) { return std::move(features[i]); });
+  return runs;
+}
+
+}  // namespace tiles
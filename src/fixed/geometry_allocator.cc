@@ -0,0 +1,73 @@
+#include "tiles/fixed/geometry_allocator.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace tiles {
+
+void geometry_arena::reset() {
+  // the first chunks are the ones which are used by every tile
+  auto retained = size_t{0};
+  auto keep = size_t{0};
+  while (keep < chunks_.size() &&
+         retained + chunks_[keep].size_ <= kMaxRetainedBytes) {
+    retained += chunks_[keep].size_;
+    ++keep;
+  }
+  chunks_.resize(keep);
+
+  curr_chunk_ = 0;
+  curr_offset_ = 0;
+}
+
+void* geometry_arena::do_allocate(size_t const bytes, size_t const alignment) {
+  while (curr_chunk_ < chunks_.size()) {
+    auto& c = chunks_[curr_chunk_];
+    auto const base = reinterpret_cast<std::uintptr_t>(c.data_.get());
+    auto const aligned =
+        (base + curr_offset_ + alignment - 1) / alignment * alignment;
+    if (aligned + bytes <= base + c.size_) {
+      curr_offset_ = aligned + bytes - base;
+      return reinterpret_cast<void*>(aligned);
+    }
+    ++curr_chunk_;
+    curr_offset_ = 0;
+  }
+
+  auto const size = std::max({kMinChunkSize, bytes + alignment,
+                              chunks_.empty() ? 0 : chunks_.back().size_ * 2});
+  chunks_.push_back({std::make_unique_for_overwrite<std::byte[]>(size), size});
+  curr_chunk_ = chunks_.size() - 1;
+  curr_offset_ = 0;
+  return do_allocate(bytes, alignment);
+}
+
+std::pmr::memory_resource*& current_geometry_resource() {
+  thread_local std::pmr::memory_resource* resource =
+      std::pmr::new_delete_resource();
+  return resource;
+}
+
+namespace {
+
+geometry_arena& get_geometry_arena() {
+  thread_local geometry_arena arena;
+  return arena;
+}
+
+}  // namespace
+
+geometry_arena_scope::geometry_arena_scope()
+    : prev_{current_geometry_resource()},
+      outermost_{prev_ != &get_geometry_arena()} {
+  current_geometry_resource() = &get_geometry_arena();
+}
+
+geometry_arena_scope::~geometry_arena_scope() {
+  current_geometry_resource() = prev_;
+  if (outermost_) {
+    get_geometry_arena().reset();
+  }
+}
+
+}  // namespace tiles
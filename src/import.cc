@@ -3,10 +3,13 @@
 #include "conf/configuration.h"
 #include "conf/options_parser.h"
 
+#include "tiles/db/build_id.h"
+#include "tiles/db/content_tree.h"
 #include "tiles/db/clear_database.h"
 #include "tiles/db/database_stats.h"
 #include "tiles/db/feature_inserter_mt.h"
 #include "tiles/db/feature_pack.h"
+#include "tiles/db/migrate_feature_keys.h"
 #include "tiles/db/pack_file.h"
 #include "tiles/db/prepare_tiles.h"
 #include "tiles/db/tile_database.h"
@@ -25,7 +28,9 @@ struct import_settings : public conf::configuration {
     param(tmp_dname_, "tmp_dname", "/path/to/tmp/directory");
     param(tasks_, "tasks",
           "'all' or any combination of: 'coastlines', "
-          "'features', 'stats', 'pack', 'tiles'");
+          "'features', 'migrate', 'stats', 'pack', 'tiles'");
+    param(columnar_packs_, "columnar_packs",
+          "pack: write v3 (columnar) feature packs");
   }
 
   bool has_any_task(std::vector<std::string> const& query) const {
@@ -41,6 +46,7 @@ struct import_settings : public conf::configuration {
   std::string coastlines_fname_{"land-polygons-complete-4326.zip"};
   std::string tmp_dname_{"."};
   std::vector<std::string> tasks_{{"all"}};
+  bool columnar_packs_{false};
 };
 
 int run_tiles_import(int argc, char const** argv) {
@@ -79,7 +85,8 @@ int run_tiles_import(int argc, char const** argv) {
 
   {
     feature_inserter_mt inserter{
-        dbi_handle{db_handle, db_handle.features_dbi_opener()}, pack_handle};
+        dbi_handle{db_handle, db_handle.features_dbi_opener()}, pack_handle,
+        db_handle.feature_key_layout_};
 
     if (opt.has_any_task({"coastlines"})) {
       auto const t = scoped_timer{"load coastlines"};
@@ -93,13 +100,29 @@ int run_tiles_import(int argc, char const** argv) {
     }
   }
 
+  // older databases: rewrite the feature index keys in z-order
+  if (opt.has_any_task({"migrate"})) {
+    t_log("migrate feature keys");
+    migrate_feature_keys(db_handle, kDefaultFeatureKeyLayout);
+  }
+
   if (opt.has_any_task({"stats"})) {
     database_stats(db_handle, pack_handle);
   }
 
   if (opt.has_any_task({"pack"})) {
     t_log("pack features");
-    pack_features(db_handle, pack_handle);
+    pack_features(db_handle, pack_handle,
+                  opt.columnar_packs_ ? feature_pack_format::v3
+                                      : feature_pack_format::v2);
+  }
+
+  // before prepare_tiles: uses it to skip empty tiles
+  if (opt.has_any_task({"coastlines", "features", "pack"})) {
+    t_log("store content tree");
+    auto txn = db_handle.make_txn();
+    store_content_tree(db_handle, txn);
+    txn.commit();
   }
 
   if (opt.has_any_task({"tiles"})) {
@@ -107,6 +130,14 @@ int run_tiles_import(int argc, char const** argv) {
     prepare_tiles(db_handle, pack_handle, 10);
   }
 
+  if (opt.has_any_task({"coastlines", "features", "pack", "tiles"})) {
+    auto txn = db_handle.make_txn();
+    auto const build_id = make_build_id();
+    store_build_id(db_handle, txn, build_id);
+    txn.commit();
+    t_log("new build id: {}", build_id);
+  }
+
   t_log("import done!");
   return 0;
 }
@@ -2,24 +2,23 @@
 
 #include <iostream>
 #include <limits>
-#include <unordered_set>
-
-#include "boost/algorithm/string/predicate.hpp"
-
-#include "utl/get_or_create.h"
-#include "utl/get_or_create_index.h"
+#include <optional>
 
 #include "tiles/bin_utils.h"
 #include "tiles/feature/aggregate_line_features.h"
 #include "tiles/feature/aggregate_polygon_features.h"
+#include "tiles/feature/deserialize.h"
 #include "tiles/fixed/algo/area.h"
 #include "tiles/fixed/algo/clip.h"
 #include "tiles/fixed/algo/shift.h"
 #include "tiles/fixed/io/deserialize.h"
 #include "tiles/fixed/io/dump.h"
+#include "tiles/flat_id_set.h"
 #include "tiles/get_tile.h"
 #include "tiles/mvt/encode_geometry.h"
 #include "tiles/mvt/tags.h"
+#include "tiles/shared_tag_cache.h"
+#include "tiles/string_interner.h"
 #include "tiles/util.h"
 
 using namespace protozero;
@@ -33,26 +32,91 @@ constexpr auto const kScreenPixelArea =
     (kVectorTileExtend / kRasterTileExtend) *
     (kVectorTileExtend / kRasterTileExtend);
 
+// Everything a layer_builder needs to allocate. Kept per thread and reused
+// for the next tiles: once the largest tile has been seen, rendering stops
+// allocating for these (server render threads and prepare_tiles workers).
+struct layer_scratch {
+  void clear() {
+    buf_.clear();
+    feature_buf_.clear();
+    tags_.clear();
+    line_buffer_.clear();
+    polygon_buffer_.clear();
+    meta_key_cache_.clear();
+    meta_value_cache_.clear();
+    shared_tag_cache_.clear();
+    node_ids_.clear();
+    line_ids_.clear();
+    poly_ids_.clear();
+  }
+
+  std::string buf_, feature_buf_;
+  std::vector<uint32_t> tags_;
+
+  std::vector<feature> line_buffer_, polygon_buffer_;
+
+  string_interner meta_key_cache_, meta_value_cache_;
+  shared_tag_cache shared_tag_cache_;
+
+  flat_id_set node_ids_, line_ids_, poly_ids_;
+};
+
+struct layer_scratch_pool {
+  std::unique_ptr<layer_scratch> acquire() {
+    if (free_.empty()) {
+      return std::make_unique<layer_scratch>();
+    }
+    auto scratch = std::move(free_.back());
+    free_.pop_back();
+    return scratch;
+  }
+
+  void release(std::unique_ptr<layer_scratch> scratch) {
+    scratch->clear();
+    free_.emplace_back(std::move(scratch));
+  }
+
+  std::vector<std::unique_ptr<layer_scratch>> free_;
+};
+
+layer_scratch_pool& get_layer_scratch_pool() {
+  thread_local layer_scratch_pool pool;
+  return pool;
+}
+
 struct layer_builder {
-  layer_builder(render_ctx const& ctx, std::string layer_name,
+  layer_builder(render_ctx const& ctx, std::string_view layer_name,
                 tile_spec const& spec)
       : ctx_{ctx},
-        layer_name_{std::move(layer_name)},
+        layer_name_{layer_name},
         spec_{spec},
         has_geometry_{false},
-        pb_{buf_} {
+        scratch_{get_layer_scratch_pool().acquire()},
+        line_buffer_{scratch_->line_buffer_},
+        polygon_buffer_{scratch_->polygon_buffer_},
+        buf_{scratch_->buf_},
+        pb_{buf_},
+        meta_key_cache_{scratch_->meta_key_cache_},
+        meta_value_cache_{scratch_->meta_value_cache_} {
     pb_.add_uint32(ttm::Layer::required_uint32_version, 2);
     pb_.add_string(ttm::Layer::required_string_name, layer_name_);
     pb_.add_uint32(ttm::Layer::optional_uint32_extent, kVectorTileExtend);
   }
 
+  ~layer_builder() { get_layer_scratch_pool().release(std::move(scratch_)); }
+
+  layer_builder(layer_builder const&) = delete;
+  layer_builder(layer_builder&&) = delete;
+  layer_builder& operator=(layer_builder const&) = delete;
+  layer_builder& operator=(layer_builder&&) = delete;
+
   void add_feature(feature f) {
     if ((mpark::holds_alternative<fixed_point>(f.geometry_) &&
-         !node_ids_.insert(f.id_).second) ||
+         !scratch_->node_ids_.insert(f.id_)) ||
         (mpark::holds_alternative<fixed_polyline>(f.geometry_) &&
-         !line_ids_.insert(f.id_).second) ||
+         !scratch_->line_ids_.insert(f.id_)) ||
         (mpark::holds_alternative<fixed_polygon>(f.geometry_) &&
-         !poly_ids_.insert(f.id_).second)) {
+         !scratch_->poly_ids_.insert(f.id_))) {
       return;
     }
 
@@ -82,28 +146,51 @@ struct layer_builder {
     has_geometry_ = true;
     ++features_written_;
 
-    std::string feature_buf;
+    auto& feature_buf = scratch_->feature_buf_;
+    feature_buf.clear();
     pbf_builder<ttm::Feature> feature_pb(feature_buf);
 
     encode_geometry(feature_pb, f.geometry_, spec_);
 
     feature_pb.add_uint64(ttm::Feature::optional_uint64_id, f.id_);
-    write_metadata(feature_pb, f.meta_);
+    write_metadata(feature_pb, f);
     pb_.add_message(ttm::Layer::repeated_Feature_features, feature_buf);
   }
 
-  void write_metadata(pbf_builder<ttm::Feature>& pb,
-                      std::vector<metadata> const& meta) {
-    std::vector<uint32_t> t;
+  void write_metadata(pbf_builder<ttm::Feature>& pb, feature const& f) {
+    auto& t = scratch_->tags_;
+    t.clear();
 
-    for (auto const& m : meta) {
-      if (m.key_ == "layer" || boost::starts_with(m.key_, "__")) {
-        continue;
+    auto const make_tag = [&](std::string_view const key,
+                              std::string_view const value) {
+      if (key == "layer" || key.starts_with("__")) {
+        return shared_tag_cache::kSkip;
       }
-
-      t.emplace_back(utl::get_or_create_index(meta_key_cache_, m.key_));
-      t.emplace_back(utl::get_or_create_index(meta_value_cache_, m.value_));
-    }
+      return shared_tag_cache::tag{
+          static_cast<uint32_t>(meta_key_cache_.get_or_create(key)),
+          static_cast<uint32_t>(meta_value_cache_.get_or_create(value))};
+    };
+    auto const add_tag = [&](shared_tag_cache::tag const tag) {
+      if (tag != shared_tag_cache::kSkip) {
+        t.emplace_back(tag.key_);
+        t.emplace_back(tag.value_);
+      }
+    };
+
+    // the only place packed metadata is resolved: features which were
+    // clipped away or dropped never pay for it. shared pairs are interned
+    // by id, only the uncoded strings are hashed.
+    for_each_metadata(
+        f,
+        [&](uint64_t const id, shared_metadata_decoder const& decoder) {
+          add_tag(scratch_->shared_tag_cache_.get_or_create(id, [&] {
+            auto const& m = decoder.decode(id);
+            return make_tag(m.key_, m.value_);
+          }));
+        },
+        [&](std::string_view const key, std::string_view const value) {
+          add_tag(make_tag(key, value));
+        });
 
     pb.add_packed_uint32(ttm::Feature::packed_uint32_tags, begin(t), end(t));
   }
@@ -137,25 +224,19 @@ struct layer_builder {
     }
   }
 
-  std::string finish() {
-    std::vector<std::string const*> keys(meta_key_cache_.size());
-    for (auto const& pair : meta_key_cache_) {
-      keys[pair.second] = &pair.first;
-    }
-    for (auto const& key : keys) {
-      pb_.add_string(ttm::Layer::repeated_string_keys, *key);
+  // the result stays valid until the layer_builder is destroyed
+  std::string const& finish() {
+    for (auto i = 0ULL; i < meta_key_cache_.size(); ++i) {
+      pb_.add_string(ttm::Layer::repeated_string_keys, meta_key_cache_.at(i));
     }
 
-    std::vector<std::string const*> values(meta_value_cache_.size());
-    for (auto const& pair : meta_value_cache_) {
-      values[pair.second] = &pair.first;
-    }
-    for (auto const& value : values) {
+    for (auto i = 0ULL; i < meta_value_cache_.size(); ++i) {
+      auto const value = meta_value_cache_.at(i);
       pbf_builder<ttm::Value> val_pb(pb_, ttm::Layer::repeated_Value_values);
 
       static_assert(sizeof(metadata_value_t) == 1);
-      utl::verify(!value->empty(), "tile_builder: have empty value");
-      switch (read<metadata_value_t>(value->data())) {
+      utl::verify(!value.empty(), "tile_builder: have empty value");
+      switch (read<metadata_value_t>(value.data())) {
         case metadata_value_t::bool_false:
           val_pb.add_bool(ttm::Value::optional_bool_bool_value, false);
           break;
@@ -164,19 +245,19 @@ struct layer_builder {
           break;
         case metadata_value_t::string:
           val_pb.add_string(ttm::Value::optional_string_string_value,
-                            value->data() + 1, value->size() - 1);
+                            value.data() + 1, value.size() - 1);
           break;
         case metadata_value_t::numeric:
-          utl::verify(value->size() == 1 + sizeof(double),
+          utl::verify(value.size() == 1 + sizeof(double),
                       "tile_builder: invalid numeric feature");
           val_pb.add_double(ttm::Value::optional_double_double_value,
-                            read<double>(value->data(), 1));
+                            read<double>(value.data(), 1));
           break;
         case metadata_value_t::integer:
-          utl::verify(value->size() == 1 + sizeof(int64_t),
+          utl::verify(value.size() == 1 + sizeof(int64_t),
                       "tile_builder: invalid integer feature");
           val_pb.add_sint64(ttm::Value::optional_sint64_sint_value,
-                            read<int64_t>(value->data(), 1));
+                            read<int64_t>(value.data(), 1));
           break;
         default: throw utl::fail("tile_builder: unknown metadata_value_t");
       }
@@ -193,46 +274,57 @@ struct layer_builder {
   }
 
   render_ctx const& ctx_;
-  std::string layer_name_;
+  std::string_view layer_name_;
   tile_spec const& spec_;
 
   bool has_geometry_;
 
-  std::vector<feature> line_buffer_, polygon_buffer_;
+  std::unique_ptr<layer_scratch> scratch_;
 
-  std::string buf_;
-  pbf_builder<ttm::Layer> pb_;
+  std::vector<feature>& line_buffer_;
+  std::vector<feature>& polygon_buffer_;
 
-  std::map<std::string, size_t> meta_key_cache_;
-  std::map<std::string, size_t> meta_value_cache_;
+  std::string& buf_;
+  pbf_builder<ttm::Layer> pb_;
 
-  std::unordered_set<uint64_t> node_ids_, line_ids_, poly_ids_;
+  string_interner& meta_key_cache_;
+  string_interner& meta_value_cache_;
 
   size_t features_added_{0};
   size_t features_written_{0};
 };
 
 struct tile_builder::impl {
-  impl(render_ctx const& ctx, geo::tile const& tile) : ctx_{ctx}, spec_{tile} {}
+  impl(render_ctx const& ctx, geo::tile const& tile)
+      : ctx_{ctx}, spec_{tile}, builders_(ctx.layer_names_.size()) {}
 
   void add_feature(feature f) {
     utl::verify(f.layer_ < ctx_.layer_names_.size(), "invalid layer in db");
-    auto& builder = utl::get_or_create(builders_, f.layer_, [&] {
-      return std::make_unique<layer_builder>(
-          ctx_, ctx_.layer_names_.at(f.layer_), spec_);
-    });
+    auto& builder = builders_[f.layer_];
+    if (!builder) {
+      builder.emplace(ctx_, ctx_.layer_names_[f.layer_], spec_);
+    }
     builder->add_feature(std::move(f));
   }
 
   std::string finish() {
+    auto size = size_t{0};
+    for (auto& builder : builders_) {
+      if (builder) {
+        builder->aggregate_geometry();
+        if (builder->has_geometry_) {
+          size += builder->finish().size() + 16;  // + tag and length
+        }
+      }
+    }
+
     std::string buf;
+    buf.reserve(size);
     pbf_builder<ttm::Tile> pb(buf);
 
-    for (auto const& pair : builders_) {
-      pair.second->aggregate_geometry();
-
-      if (pair.second->has_geometry_) {
-        pb.add_message(ttm::Tile::repeated_Layer_layers, pair.second->finish());
+    for (auto const& builder : builders_) {
+      if (builder && builder->has_geometry_) {
+        pb.add_message(ttm::Tile::repeated_Layer_layers, builder->buf_);
       }
     }
 
@@ -250,10 +342,9 @@ struct tile_builder::impl {
         buf.append(fmt::format("[x={}, y={}, z={}]", spec_.tile_.x_,
                                spec_.tile_.y_, spec_.tile_.z_));
 
-        std::vector<uint32_t> t{static_cast<uint32_t>(utl::get_or_create_index(
-                                    lb.meta_key_cache_, "tile_id")),
-                                static_cast<uint32_t>(utl::get_or_create_index(
-                                    lb.meta_value_cache_, buf))};
+        std::vector<uint32_t> t{
+            static_cast<uint32_t>(lb.meta_key_cache_.get_or_create("tile_id")),
+            static_cast<uint32_t>(lb.meta_value_cache_.get_or_create(buf))};
         feature_pb.add_packed_uint32(ttm::Feature::packed_uint32_tags, begin(t),
                                      end(t));
 
@@ -284,7 +375,7 @@ struct tile_builder::impl {
 
   render_ctx const& ctx_;
   tile_spec spec_;
-  std::map<size_t, std::unique_ptr<layer_builder>> builders_;
+  std::vector<std::optional<layer_builder>> builders_;  // index: layer
 };
 
 tile_builder::tile_builder(render_ctx const& ctx, geo::tile const& tile)
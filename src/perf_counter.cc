@@ -30,6 +30,7 @@ void print(char const* label, std::vector<uint64_t>& m) {
 
 void perf_report_get_tile(perf_counter& pc) {
   print<printable_bytes>(" RESULT: SIZE", pc.finished_[perf_task::RESULT_SIZE]);
+  print<printable_num>(" RESULT: ALLOCS", pc.finished_[perf_task::ALLOCATIONS]);
 
   print<printable_ns>(" GET: TOTAL", pc.finished_[perf_task::GET_TILE_TOTAL]);
   print<printable_ns>(" GET: FETCH", pc.finished_[perf_task::GET_TILE_FETCH]);
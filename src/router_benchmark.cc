@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "conf/configuration.h"
+#include "conf/options_parser.h"
+
+#include "fmt/core.h"
+#include "fmt/ostream.h"
+
+#include "tiles/perf_counter.h"
+#include "tiles/server/router.h"
+#include "tiles/util.h"
+
+namespace tiles {
+
+struct router_benchmark_settings : public conf::configuration {
+  router_benchmark_settings()
+      : configuration("tiles-router-benchmark options", "") {
+    param(iterations_, "iterations", "number of routed requests");
+  }
+
+  size_t iterations_{10'000'000};
+};
+
+// request targets as sent by mapbox-gl (mostly tiles, some glyphs)
+std::vector<std::string> make_targets() {
+  std::vector<std::string> targets;
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<uint32_t> z_dist{0, 20};
+  for (auto i = 0; i < 1000; ++i) {
+    auto const z = z_dist(gen);
+    auto const max = (1U << z) - 1;
+    std::uniform_int_distribution<uint32_t> xy_dist{0, max};
+    targets.emplace_back(
+        fmt::format("/{}/{}/{}.mvt", z, xy_dist(gen), xy_dist(gen)));
+  }
+  for (auto i = 0; i < 100; ++i) {
+    targets.emplace_back(
+        fmt::format("/glyphs/Noto%20Sans%20Display%20Regular/{}-{}.pbf",
+                    i * 256, i * 256 + 255));
+  }
+  targets.emplace_back("/");
+  targets.emplace_back("/mapbox-gl.js");
+  targets.emplace_back("/metrics");
+  std::shuffle(begin(targets), end(targets), gen);
+  return targets;
+}
+
+int run_router_benchmark(int argc, char const** argv) {
+  router_benchmark_settings opt;
+
+  try {
+    conf::options_parser parser({&opt});
+    parser.read_command_line_args(argc, argv, false);
+
+    if (parser.help()) {
+      std::cout << "tiles-router-benchmark\n\n";
+      parser.print_help(std::cout);
+      return 0;
+    } else if (parser.version()) {
+      std::cout << "tiles-router-benchmark\n";
+      return 0;
+    }
+
+    parser.read_configuration_file(false);
+    parser.print_used(std::cout);
+  } catch (std::exception const& e) {
+    std::cout << "options error: " << e.what() << "\n";
+    return 1;
+  }
+
+  auto const targets = make_targets();
+
+  url_buffer_t buf;
+  auto checksum = size_t{0};  // keeps the optimizer honest
+  auto const allocations_before = thread_allocation_count();
+  auto const start = std::chrono::steady_clock::now();
+  for (auto i = size_t{0}; i < opt.iterations_; ++i) {
+    auto const route = route_request(targets[i % targets.size()], buf);
+    checksum += static_cast<size_t>(route.endpoint_) + route.tile_.x_ +
+                route.name_.size();
+  }
+  auto const end = std::chrono::steady_clock::now();
+  auto const allocations = thread_allocation_count() - allocations_before;
+
+  using namespace std::chrono;
+  auto const ns = duration_cast<nanoseconds>(end - start).count();
+  fmt::print(std::cout,
+             "{} requests ({} distinct targets) in {}ms: {:.1f}ns / request, "
+             "{} allocations [checksum {}]\n",
+             opt.iterations_, targets.size(), ns / 1'000'000,
+             static_cast<double>(ns) / static_cast<double>(opt.iterations_),
+             allocations, checksum);
+  return 0;
+}
+
+}  // namespace tiles
+
+int main(int argc, char const** argv) {
+  try {
+    return tiles::run_router_benchmark(argc, argv);
+  } catch (std::exception const& e) {
+    tiles::t_log("exception caught: {}", e.what());
+    return 1;
+  } catch (...) {
+    tiles::t_log("unknown exception caught");
+    return 1;
+  }
+}
@@ -3,10 +3,18 @@
 #include <filesystem>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 
-#include "boost/algorithm/string/predicate.hpp"
 #include "boost/asio.hpp"
 #include "boost/beast/core.hpp"
 #include "boost/beast/http.hpp"
@@ -15,13 +23,25 @@
 #include "conf/configuration.h"
 #include "conf/options_parser.h"
 
-#include "utl/parser/mmap_reader.h"
-
+#include "tiles/cancel_token.h"
+#include "tiles/db/build_id.h"
+#include "tiles/db/read_txn_pool.h"
 #include "tiles/db/tile_database.h"
 #include "tiles/get_tile.h"
-#include "tiles/parse_tile_url.h"
 #include "tiles/perf_counter.h"
+#include "tiles/server/access_log.h"
+#include "tiles/server/content_encoding.h"
+#include "tiles/server/http_caching.h"
+#include "tiles/server/perf_metrics.h"
+#include "tiles/server/render_pool.h"
+#include "tiles/server/router.h"
+#include "tiles/server/shared_body.h"
+#include "tiles/server/single_flight.h"
+#include "tiles/server/static_resources.h"
+#include "tiles/server/tile_batch.h"
+#include "tiles/server/tile_cache.h"
 #include "tiles/util.h"
+#include "tiles/zoom_band.h"
 
 #include "pbf_sdf_fonts_res.h"
 #include "tiles_server_res.h"
@@ -37,68 +57,215 @@ using tcp = boost::asio::ip::tcp;  // from "boost/asio/ip/tcp.hpp"
 namespace tiles {
 
 using request_t = http::request<http::dynamic_body>;
-using response_t = http::response<http::string_body>;
-using callback_t = std::function<void(request_t const&, response_t&)>;
-
-std::string url_decode(request_t const& req) {
-  auto const& in = req.target();
-  std::string out;
-  out.reserve(in.size());
-  for (std::size_t i = 0; i < in.size(); ++i) {
-    if (in[i] == '%') {
-      utl::verify(i + 3 <= in.size(), "invalid url");
-      int value = 0;
-      std::istringstream is{std::string{in.substr(i + 1, 2)}};
-      utl::verify(static_cast<bool>(is >> std::hex >> value), "invalid url");
-      out += static_cast<char>(value);
-      i += 2;
-    } else if (in[i] == '+') {
-      out += ' ';
-    } else {
-      out += in[i];
+using response_t = http::response<shared_body>;
+using reply_fn_t = std::function<void()>;
+using on_disconnect_fn_t = std::function<void(std::function<void()>)>;
+
+// reply of a request handler: logs the request, then replies
+// (render time: zero if nothing was rendered for the request)
+using log_reply_fn_t = std::function<void(std::chrono::nanoseconds render)>;
+
+// the callback must call reply exactly once, as soon as the response is
+// ready (possibly from another thread), or throw before doing so
+//
+// on_disconnect (only to be called by the callback itself, not later)
+// registers a function which is called if the client disconnects before
+// the response is ready
+using callback_t = std::function<void(request_t const&, response_t&,
+                                      reply_fn_t, on_disconnect_fn_t)>;
+
+struct http_settings {
+  std::string address_;
+  uint16_t port_;
+  std::chrono::seconds idle_timeout_{15};
+  size_t max_requests_{1000};
+  bool reuse_port_{false};
+  bool pin_threads_{false};
+};
+
+// Either one io_context which is run by all threads, or one io_context per
+// thread ("shards"): then every shard has its own SO_REUSEPORT acceptor,
+// the kernel distributes the connections and each connection stays on the
+// thread which accepted it.
+using io_contexts_t = std::vector<std::unique_ptr<net::io_context>>;
+
+io_contexts_t make_io_contexts(http_settings const& settings) {
+  auto const threads = std::max(1U, std::thread::hardware_concurrency());
+
+  io_contexts_t iocs;
+  if (settings.reuse_port_) {
+    for (auto i = 0U; i < threads; ++i) {
+      iocs.emplace_back(std::make_unique<net::io_context>(1));
     }
+  } else {
+    iocs.emplace_back(
+        std::make_unique<net::io_context>(static_cast<int>(threads)));
   }
-  return out;
+  return iocs;
+}
+
+void pin_current_thread(unsigned const core) {
+#if defined(__linux__)
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(core % CPU_SETSIZE, &cpu_set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) !=
+      0) {
+    t_log("could not pin thread to core {}", core);
+  }
+#else
+  t_log("thread pinning not supported, ignoring core {}", core);
+#endif
 }
 
 struct http_connection : public std::enable_shared_from_this<http_connection> {
-  http_connection(tcp::socket socket, callback_t const& callback)
-      : socket_{std::move(socket)}, callback_{callback} {}
+  http_connection(tcp::socket socket, callback_t const& callback,
+                  http_settings const& settings)
+      : socket_{std::move(socket)}, callback_{callback}, settings_{settings} {}
 
   void start() {
+    read_request();
+    check_deadline();
+  }
+
+  // the deadline covers the idle time before a request, as well as the
+  // time it takes to answer it
+  void read_request() {
     auto self = shared_from_this();
-    http::async_read(
-        socket_, buffer_, request_, [self](beast::error_code ec, std::size_t) {
-          if (!ec) {
-            self->response_.version(self->request_.version());
-            self->response_.keep_alive(false);
-
-            try {
-              self->callback_(self->request_, self->response_);
-            } catch (std::exception const& e) {
-              tiles::t_log("unhandled error: {}", e.what());
-              self->response_.result(http::status::internal_server_error);
-            } catch (...) {
-              tiles::t_log("unhandled unknown error");
-              self->response_.result(http::status::internal_server_error);
+    request_ = {};
+    deadline_.expires_after(settings_.idle_timeout_);
+    http::async_read(socket_, buffer_, request_,
+                     [self](beast::error_code ec, std::size_t) {
+                       if (ec) {
+                         self->close();
+                         return;
+                       }
+                       self->handle_request();
+                     });
+  }
+
+  void handle_request() {
+    ++requests_served_;
+    deadline_.expires_after(settings_.idle_timeout_);
+
+    response_ = {};
+    response_.version(request_.version());
+    response_.keep_alive(request_.keep_alive() &&
+                         requests_served_ < settings_.max_requests_);
+
+    auto self = shared_from_this();
+    awaiting_reply_ = true;
+    try {
+      callback_(
+          request_, response_,
+          [self] {
+            net::post(self->socket_.get_executor(),
+                      [self] { self->write_response(); });
+          },
+          [self](std::function<void()> fn) {
+            self->on_disconnect_ = std::move(fn);
+          });
+      if (on_disconnect_) {
+        watch_disconnect();
+      }
+    } catch (std::exception const& e) {
+      tiles::t_log("unhandled error: {}", e.what());
+      response_.result(http::status::internal_server_error);
+      write_response();
+    } catch (...) {
+      tiles::t_log("unhandled unknown error");
+      response_.result(http::status::internal_server_error);
+      write_response();
+    }
+  }
+
+  // a client which resets the connection while its request is pending
+  // (e.g. a map which was panned away) does not need the response anymore
+  //
+  // - end of stream is no disconnect: the client may only have shut down
+  //   its sending side and still waits for the response
+  // - pipelined requests are moved to buffer_ (read_request parses them
+  //   from there) to keep watching, until the buffer is full
+  void watch_disconnect() {
+    auto self = shared_from_this();
+    socket_.async_wait(
+        tcp::socket::wait_read,
+        [self, request = requests_served_](beast::error_code ec) {
+          if (ec || !self->awaiting_reply_ ||
+              self->requests_served_ != request) {
+            return;
+          }
+
+          auto& buffer = self->buffer_;
+          if (auto const available = self->socket_.available(ec);
+              !ec && available != 0) {
+            auto const space = buffer.max_size() - buffer.size();
+            if (space == 0) {
+              return;
+            }
+            auto const n = self->socket_.receive(
+                buffer.prepare(std::min(available, space)), 0, ec);
+            if (!ec) {
+              buffer.commit(n);
+              self->watch_disconnect();
+              return;
             }
-            self->response_.set(http::field::content_length,
-                                std::to_string(self->response_.body().size()));
-            http::async_write(self->socket_, self->response_,
-                              [self](beast::error_code ec, std::size_t) {
-                                self->socket_.shutdown(
-                                    tcp::socket::shutdown_send, ec);
-                                self->deadline_.cancel();
-                              });
+          } else if (!ec) {
+            char c = 0;  // readable without data: end of stream or error
+            self->socket_.receive(net::buffer(&c, 1),
+                                  tcp::socket::message_peek, ec);
+          }
+
+          if (ec && ec != net::error::eof && self->on_disconnect_) {
+            auto const on_disconnect = std::move(self->on_disconnect_);
+            self->on_disconnect_ = nullptr;
+            on_disconnect();
           }
         });
-    check_deadline();
+  }
+
+  void write_response() {
+    awaiting_reply_ = false;
+    on_disconnect_ = nullptr;
+
+    response_.set(http::field::content_length,
+                  std::to_string(response_.body().size()));
+    if (request_.method() == http::verb::head) {
+      // keep content-length, but never send a body on a persistent connection
+      response_.body().clear();
+    }
+
+    auto self = shared_from_this();
+    http::async_write(socket_, response_,
+                      [self](beast::error_code ec, std::size_t) {
+                        // drop the body owner (e.g. a read transaction)
+                        // instead of keeping it while the connection idles
+                        self->response_.body().clear();
+                        if (ec || !self->response_.keep_alive()) {
+                          self->close();
+                          return;
+                        }
+                        // pipelined requests may already be in buffer_
+                        self->read_request();
+                      });
+  }
+
+  void close() {
+    closed_ = true;
+    beast::error_code ec;
+    socket_.shutdown(tcp::socket::shutdown_send, ec);
+    deadline_.cancel();
   }
 
   void check_deadline() {
     auto self = shared_from_this();
     deadline_.async_wait([self](beast::error_code ec) {
-      if (!ec) {
+      if (self->closed_) {
+        return;
+      } else if (ec == net::error::operation_aborted &&
+                 self->deadline_.expiry() > std::chrono::steady_clock::now()) {
+        self->check_deadline();  // deadline was moved: keep waiting
+      } else if (!ec) {
         self->socket_.close(ec);
       }
     });
@@ -109,37 +276,82 @@ struct http_connection : public std::enable_shared_from_this<http_connection> {
   request_t request_;
   response_t response_;
   callback_t const& callback_;
-  net::steady_timer deadline_{socket_.get_executor(), std::chrono::seconds(60)};
+  http_settings const& settings_;
+  size_t requests_served_{0};
+  bool awaiting_reply_{false};
+  std::function<void()> on_disconnect_;
+  bool closed_{false};
+  net::steady_timer deadline_{socket_.get_executor(), settings_.idle_timeout_};
 };
 
-void http_server(tcp::acceptor& acceptor, tcp::socket& socket,
+// each connection gets its own strand: handlers and the deadline timer of
+// one connection never run concurrently
+void http_server(tcp::acceptor& acceptor, http_settings const& settings,
                  callback_t const& cb) {
-  acceptor.async_accept(socket, [&](beast::error_code ec) {
-    if (!ec) {
-      std::make_shared<http_connection>(std::move(socket), cb)->start();
-    }
-    http_server(acceptor, socket, cb);
-  });
+  acceptor.async_accept(
+      net::make_strand(acceptor.get_executor()),
+      [&](beast::error_code ec, tcp::socket socket) {
+        if (!ec) {
+          std::make_shared<http_connection>(std::move(socket), cb, settings)
+              ->start();
+        }
+        http_server(acceptor, settings, cb);
+      });
 }
 
-void serve_forever(std::string const& address, uint16_t port, callback_t&& cb) {
+void serve_forever(io_contexts_t& iocs, http_settings const& settings,
+                   callback_t&& cb) {
   try {
-    net::io_context ioc{static_cast<int>(std::thread::hardware_concurrency())};
-    tcp::acceptor acceptor{ioc, {net::ip::make_address(address), port}};
-    tcp::socket socket{ioc};
-    http_server(acceptor, socket, cb);
+    auto const sharded = settings.reuse_port_;
+    auto const endpoint =
+        tcp::endpoint{net::ip::make_address(settings.address_), settings.port_};
 
-    boost::asio::signal_set signals(ioc, SIGINT, SIGTERM);
-    signals.async_wait(
-        [&](boost::system::error_code const&, int) { ioc.stop(); });
+    std::vector<std::unique_ptr<tcp::acceptor>> acceptors;
+    for (auto& ioc : iocs) {
+      auto& acceptor =
+          acceptors.emplace_back(std::make_unique<tcp::acceptor>(*ioc));
+      acceptor->open(endpoint.protocol());
+      acceptor->set_option(tcp::acceptor::reuse_address{true});
+      if (settings.reuse_port_) {
+#if defined(SO_REUSEPORT)
+        using reuse_port =
+            net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+        acceptor->set_option(reuse_port{true});
+#else
+        utl::fail("SO_REUSEPORT not supported on this platform");
+#endif
+      }
+      acceptor->bind(endpoint);
+      acceptor->listen();
+      http_server(*acceptor, settings, cb);
+    }
+
+    boost::asio::signal_set signals(*iocs.front(), SIGINT, SIGTERM);
+    signals.async_wait([&](boost::system::error_code const&, int) {
+      for (auto& ioc : iocs) {
+        ioc->stop();
+      }
+    });
+
+    // thread i runs shard i (or, if not sharded, all run the only one)
+    auto const thread_count =
+        std::max(1U, std::thread::hardware_concurrency());
+    auto const run = [&](unsigned const i) {
+      if (settings.pin_threads_) {
+        pin_current_thread(i);
+      }
+      iocs[i % iocs.size()]->run();
+    };
 
     std::vector<std::thread> threads;
-    for (auto i = 1ULL; i < std::thread::hardware_concurrency(); ++i) {
-      threads.emplace_back([&ioc] { ioc.run(); });
+    for (auto i = 1U; i < thread_count; ++i) {
+      threads.emplace_back(run, i);
     }
 
-    t_log("tiles-server started on {}:{}", address, port);
-    ioc.run();
+    t_log("tiles-server started on {}:{} [{}]", settings.address_,
+          settings.port_,
+          sharded ? fmt::format("{} shards", iocs.size()) : "shared");
+    run(0);
 
     std::for_each(begin(threads), end(threads), [](auto& t) { t.join(); });
   } catch (std::exception const& e) {
@@ -147,16 +359,76 @@ void serve_forever(std::string const& address, uint16_t port, callback_t&& cb) {
   }
 }
 
+struct tile_result {
+  http::status status_;
+  tile_cache::value_t data_;  // only valid with status ok
+  std::chrono::nanoseconds render_time_{0};  // zero: not rendered
+};
+
 struct server_settings : public conf::configuration {
   server_settings() : configuration("tiles-server options", "") {
     param(db_fname_, "db_fname", "/path/to/tiles.mdb");
     param(res_dname_, "res_dname", "tiles/client");
     param(port_, "port", "the http port of the server");
+    param(tile_cache_size_, "tile_cache_size",
+          "size of the rendered tile cache in MB (0 = disabled)");
+    param(keep_alive_timeout_, "keep_alive_timeout",
+          "idle timeout of persistent connections in seconds");
+    param(keep_alive_max_requests_, "keep_alive_max_requests",
+          "max number of requests per persistent connection");
+    param(render_threads_, "render_threads",
+          "number of tile render threads (0 = hardware concurrency)");
+    param(render_queue_size_, "render_queue_size",
+          "max number of queued tile renders before answering 503");
+    param(render_timeout_, "render_timeout",
+          "max time in ms a tile render may wait in the queue");
+    param(render_budget_, "render_budget",
+          "max time in ms a tile render may take (0 = unlimited)");
+    param(reuse_port_, "reuse_port",
+          "one io_context and SO_REUSEPORT acceptor per core");
+    param(pin_threads_, "pin_threads", "pin the i/o threads to cores");
+    param(db_read_txns_, "db_read_txns",
+          "max number of pooled database read transactions "
+          "(0 = render threads + 64 for zero-copy responses)");
+    param(db_max_readers_, "db_max_readers",
+          "max number of concurrent database read transactions "
+          "(0 = db_read_txns + 8)");
+    param(tile_max_age_, "tile_max_age",
+          "Cache-Control max-age of tiles per zoom band: "
+          "'<min_z>-<max_z>:<seconds>' or '<z>:<seconds>', first match wins");
+    param(compression_level_, "compression_level",
+          "deflate level of rendered tiles per zoom band: "
+          "'<min_z>-<max_z>:<level>' or '<z>:<level>', first match wins");
+    param(server_timing_, "server_timing",
+          "send the render time of tiles as Server-Timing header");
+    param(perf_log_, "perf_log",
+          "print perf counters of every rendered tile to stdout");
+    param(access_log_sample_, "access_log_sample",
+          "write every n-th request to the access log (0 = disabled)");
+    param(access_log_rate_limit_, "access_log_rate_limit",
+          "max access log lines per second (0 = unlimited)");
   }
 
   std::string db_fname_{"tiles.mdb"};
   std::string res_dname_;
   uint16_t port_{8080};
+  size_t tile_cache_size_{256};
+  unsigned keep_alive_timeout_{15};
+  size_t keep_alive_max_requests_{1000};
+  size_t render_threads_{0};
+  size_t render_queue_size_{1024};
+  unsigned render_timeout_{10000};
+  unsigned render_budget_{0};
+  bool reuse_port_{false};
+  bool pin_threads_{false};
+  size_t db_read_txns_{0};
+  unsigned db_max_readers_{0};
+  std::vector<std::string> tile_max_age_;
+  std::vector<std::string> compression_level_;
+  bool server_timing_{false};
+  bool perf_log_{false};
+  size_t access_log_sample_{1};
+  size_t access_log_rate_limit_{1000};
 };
 
 int run_tiles_server(int argc, char const** argv) {
@@ -182,127 +454,592 @@ int run_tiles_server(int argc, char const** argv) {
   utl::verify(std::filesystem::is_regular_file(opt.db_fname_.c_str()),
               "tiles database file not found: {}", opt.db_fname_);
 
-  lmdb::env db_env = make_tile_database(opt.db_fname_.c_str(), kDefaultSize);
+  auto const render_threads = opt.render_threads_ == 0
+                                  ? std::thread::hardware_concurrency()
+                                  : opt.render_threads_;
+
+  // every pooled transaction keeps its reader slot: the pool must never
+  // run into MDB_READERS_FULL (a few more for startup and the like)
+  auto const read_txns = opt.db_read_txns_ == 0 ? render_threads + 64U
+                                                : opt.db_read_txns_;
+  auto const max_readers = opt.db_max_readers_ == 0
+                               ? static_cast<unsigned>(read_txns + 8U)
+                               : opt.db_max_readers_;
+  utl::verify(max_readers > read_txns,
+              "db_max_readers ({}) must exceed db_read_txns ({})",
+              max_readers, read_txns);
+
+  // NOTLS: read transactions of zero-copy responses are released on
+  // whichever thread finishes writing the response
+  // NORDAHEAD: tile lookups are random access
+  lmdb::env db_env = make_tile_database(
+      opt.db_fname_.c_str(), kDefaultSize,
+      lmdb::env_open_flags::NOSUBDIR | lmdb::env_open_flags::RDONLY |
+          lmdb::env_open_flags::NOTLS | lmdb::env_open_flags::NORDAHEAD,
+      max_readers);
   tile_db_handle handle{db_env};
-  auto const render_ctx = make_render_ctx(handle);
+  read_txn_pool txn_pool{handle, read_txns};
+  auto const render_ctx = [&] {
+    auto ctx = make_render_ctx(handle);
+    ctx.compression_levels_ =
+        parse_zoom_bands(opt.compression_level_, 0, kMaxCompressionLevel);
+    prepare_seaside_tile_blobs(ctx);
+    return ctx;
+  }();
   pack_handle pack_handle{opt.db_fname_.c_str()};
 
-  auto const maybe_serve_tile = [&](auto const& req, auto& res) -> bool {
-    auto const decoded_url = url_decode(req);
-    auto const match = parse_tile_url(decoded_url);
-    if (!match) {
-      return false;
+  // part of the etags: the bytes of tiles compressed on the fly depend on
+  // the compressor settings, those of prepared tiles only on the database
+  auto const compressor_tags = [&] {
+    std::vector<std::string> tags;
+    for (auto z = 0U; z <= kMaxZoomLevel; ++z) {
+      tags.emplace_back(make_compressor_tag(
+          get_zoom_band_value(render_ctx.compression_levels_, z)
+              .value_or(kDefaultCompressionLevel)));
     }
+    return tags;
+  }();
+  auto const compressor_tag = [&](geo::tile const& tile) -> std::string_view {
+    return is_prepared_zoom_level(render_ctx, tile) &&
+                   !render_ctx.seaside_tiles_.contains(tile)
+               ? std::string_view{}
+               : compressor_tags.at(tile.z_);
+  };
 
-    if (req[http::field::accept_encoding]  //
-            .find("deflate") == std::string_view::npos) {
-      res.result(http::status::not_implemented);
-      return true;
+  auto const build_id = [&] {
+    auto txn = handle.make_txn();
+    if (auto opt_build_id = get_build_id(handle, txn); opt_build_id) {
+      return *opt_build_id;
     }
+    // databases from older imports: any change rewrites the file
+    auto const mtime = std::filesystem::last_write_time(opt.db_fname_);
+    return fmt::format(
+        "{:x}-{:x}",
+        static_cast<uint64_t>(mtime.time_since_epoch().count()),
+        std::filesystem::file_size(opt.db_fname_));
+  }();
+  auto const max_age_bands = parse_zoom_bands(opt.tile_max_age_);
 
-    t_log("received a request: {}", req.target());
-    auto const tile = *match;
+  auto cache = opt.tile_cache_size_ == 0
+                   ? std::unique_ptr<tile_cache>{}
+                   : std::make_unique<tile_cache>(opt.tile_cache_size_ *
+                                                  1024ULL * 1024ULL);
 
-    perf_counter pc;
-    auto rendered_tile = get_tile(handle, pack_handle, render_ctx, tile, pc);
-    perf_report_get_tile(pc);
+  // concurrent requests for the same tile share one render
+  // the render is cancelled once all of them disconnected
+  single_flight<tile_key_t, tile_result, cancel_token> in_flight;
 
-    if (rendered_tile) {
-      res.body() = std::move(*rendered_tile);
-      res.set(http::field::content_encoding, "deflate");
-      res.result(http::status::ok);
+  // written by render and I/O threads: must outlive both
+  perf_metrics metrics;
+  access_logger access_log{
+      {.sample_every_ = opt.access_log_sample_,
+       .max_lines_per_second_ = opt.access_log_rate_limit_},
+      std::clog};
+
+  http_settings const http_opt{"0.0.0.0",
+                               opt.port_,
+                               std::chrono::seconds{opt.keep_alive_timeout_},
+                               opt.keep_alive_max_requests_,
+                               opt.reuse_port_,
+                               opt.pin_threads_};
+
+  // embedded resources are only loaded (and compressed) on first use
+  auto const embedded = [](auto const get_resource) {
+    return [get_resource](std::string const& name)
+               -> std::optional<std::string_view> {
+      try {
+        auto const mem = get_resource(name);
+        return std::string_view{reinterpret_cast<char const*>(mem.ptr_),
+                                mem.size_};
+      } catch (std::out_of_range const&) {
+        return std::nullopt;
+      }
+    };
+  };
+
+  // must outlive all connections (responses point into them)
+  static_resources glyph_resources{embedded(pbf_sdf_fonts_res::get_resource)};
+  static_resources file_resources{embedded(tiles_server_res::get_resource)};
+  if (!opt.res_dname_.empty()) {
+    if (std::filesystem::is_directory(opt.res_dname_)) {
+      file_resources.add_directory(opt.res_dname_);
+      t_log("loaded {} static resources from {}", file_resources.size(),
+            opt.res_dname_);
     } else {
-      res.result(http::status::no_content);
+      t_log("res_dname {} not found, using embedded resources only",
+            opt.res_dname_);
     }
-    return true;
+  }
+
+  // must outlive all connections and therefore the render pool
+  auto iocs = make_io_contexts(http_opt);
+
+  render_pool pool{render_threads, opt.render_queue_size_};
+
+  auto const serve_metrics = [&](auto& res) {
+    std::string buf;
+    append_prometheus_metrics(buf, metrics.snapshot());
+    if (cache) {
+      auto const s = cache->get_stats();
+      fmt::format_to(std::back_inserter(buf),
+                     "tiles_tile_cache_hits_total {}\n"
+                     "tiles_tile_cache_misses_total {}\n"
+                     "tiles_tile_cache_inserts_total {}\n"
+                     "tiles_tile_cache_evictions_total {}\n"
+                     "tiles_tile_cache_entries {}\n"
+                     "tiles_tile_cache_bytes {}\n"
+                     "tiles_tile_cache_max_bytes {}\n",
+                     s.hits_, s.misses_, s.inserts_, s.evictions_, s.entries_,
+                     s.bytes_, cache->max_bytes_);
+    }
+
+    res.body().assign(std::move(buf));
+    res.set(http::field::content_type, "text/plain; version=0.0.4");
+    res.result(http::status::ok);
   };
 
-  auto const maybe_serve_glyphs = [&](auto const& req, auto& res) -> bool {
-    static auto const matcher = regex_matcher{"^\\/glyphs/(.+)$"};
-    auto const decoded_url = url_decode(req);
-    auto const match = matcher.match(decoded_url);
-    if (!match) {
-      return false;
+  // replies on its own (possibly asynchronously)
+  auto const serve_tile = [&](auto const& req, auto& res, geo::tile const tile,
+                              log_reply_fn_t const& reply,
+                              on_disconnect_fn_t const& on_disconnect) {
+    res.set(http::field::vary, "Accept-Encoding");
+    auto const opt_encoding =
+        negotiate_encoding(req[http::field::accept_encoding]);
+    if (!opt_encoding) {
+      res.result(http::status::not_acceptable);
+      reply({});
+      return;
     }
+    auto const encoding = *opt_encoding;
 
-    try {
-      auto const mem =
-          pbf_sdf_fonts_res::get_resource(std::string{match->at(1)});
-      res.body() =
-          std::string{reinterpret_cast<char const*>(mem.ptr_), mem.size_};
+    auto const etag = make_tile_etag(
+        build_id, tile,
+        encoding == content_encoding::deflate
+            ? ""
+            : (encoding == content_encoding::gzip ? "gzip" : "identity"),
+        encoding == content_encoding::identity ? std::string_view{}
+                                               : compressor_tag(tile));
+    auto const max_age = get_zoom_band_value(max_age_bands, tile.z_);
+    auto const set_cache_headers = [etag, max_age](auto& r) {
+      r.set(http::field::etag, etag);
+      if (max_age) {
+        r.set(http::field::cache_control,
+              fmt::format("public, max-age={}", *max_age));
+      }
+    };
+
+    // stored tiles are deflate compressed: other encodings are transcoded
+    // once and cached (n of the key: encoding, deflate = 0 = rendered tile)
+    auto const encoded_key =
+        tile_to_key(tile, static_cast<tile_key_t>(encoding));
+    auto const cache_encoded =
+        cache != nullptr && encoding != content_encoding::deflate;
+    auto const encode = [&cache, encoding, encoded_key, cache_encoded](
+                            std::string_view deflated) {
+      auto encoded = tile_cache::value_t{std::make_shared<std::string const>(
+          encode_tile(encoding, deflated))};
+      if (cache_encoded) {
+        cache->put(encoded_key, encoded);
+      }
+      return encoded;
+    };
+
+    auto const set_tile_body = [encoding](auto& r, std::string_view encoded,
+                                          std::shared_ptr<void const> owner) {
+      r.body().assign(encoded, std::move(owner));
+      if (encoding != content_encoding::identity) {
+        r.set(http::field::content_encoding, encoding_name(encoding));
+      }
+    };
+
+    if (etag_matches(req[http::field::if_none_match], etag)) {
+      set_cache_headers(res);
+      res.result(http::status::not_modified);
+      reply({});
+      return;
+    }
+
+    if (!may_have_content(render_ctx, tile)) {
+      set_cache_headers(res);
+      res.result(http::status::no_content);
+      reply({});
+      return;
+    }
+
+    if (auto const encoded = cache_encoded ? cache->get(encoded_key) : nullptr;
+        encoded != nullptr) {
+      set_tile_body(res, *encoded, encoded);
+      set_cache_headers(res);
       res.result(http::status::ok);
-    } catch (std::out_of_range const&) {
-      res.result(http::status::not_found);
+      reply({});
+      return;
     }
-    return true;
-  };
 
-  auto const maybe_serve_file = [&](auto const& req, auto& res) -> bool {
-    static auto const matcher = regex_matcher{"^\\/(.+)$"};
-    auto const decoded_url = url_decode(req);
-    auto const match = matcher.match(decoded_url);
-    if (!match && req.target() != "/") {
-      res.result(http::status::not_found);
-      return false;
+    // prepared tiles are sent straight from the memory map: the read
+    // transaction keeps the pages valid until the response is written.
+    // if too many responses hold one (slow clients), a render thread
+    // copies the tile instead (the render pool never waits for them)
+    if (is_prepared_zoom_level(render_ctx, tile)) {
+      if (auto txn = txn_pool.try_acquire(render_threads); txn != nullptr) {
+        metrics_perf_counter pc{metrics};
+        if (auto const db_tile =
+                get_prepared_tile(handle, txn->txn_, tile, pc);
+            db_tile) {
+          if (encoding == content_encoding::deflate) {
+            set_tile_body(res, *db_tile, std::move(txn));
+          } else {
+            auto const encoded = encode(*db_tile);
+            set_tile_body(res, *encoded, encoded);
+          }
+          set_cache_headers(res);
+          res.result(http::status::ok);
+          reply({});
+          return;
+        }
+      }
     }
 
-    bool found = false;
-    auto const fname = std::string{match ? match->at(1) : "index.html"};
-    if (!opt.res_dname_.empty()) {
-      auto p = std::filesystem::path{opt.res_dname_} / fname;
-      if (std::filesystem::exists(p)) {
-        auto const mem = utl::mmap_reader{p.string().c_str()};
-        res.body() = std::string{mem.m_.ptr(), mem.m_.size()};
-        found = true;
+    // prepared tiles are a single database lookup anyway
+    auto const use_cache =
+        cache != nullptr &&
+        static_cast<int>(tile.z_) > render_ctx.max_prepared_zoom_level_;
+    auto const key = tile_to_key(tile);
+
+    // render time: only for the request which rendered (not for followers)
+    auto const write_tile = [&res, &opt, reply, set_cache_headers, encoding,
+                             encode, set_tile_body,
+                             tile](tile_result const& result,
+                                   bool const rendered) {
+      auto const render_time =
+          rendered ? result.render_time_ : std::chrono::nanoseconds{0};
+      if (result.status_ == http::status::ok && !result.data_->empty()) {
+        try {
+          auto const encoded = encoding == content_encoding::deflate
+                                   ? result.data_
+                                   : encode(*result.data_);
+          set_tile_body(res, *encoded, encoded);
+          set_cache_headers(res);
+          res.result(http::status::ok);
+          if (opt.server_timing_ && render_time.count() != 0) {
+            res.set("Server-Timing",
+                    fmt::format("render;dur={:.3f}",
+                                render_time.count() / 1e6));
+          }
+        } catch (std::exception const& e) {
+          t_log("encode error: {} [tile={}]", e.what(), fmt::streamed(tile));
+          res.result(http::status::internal_server_error);
+        }
+      } else if (result.status_ == http::status::ok) {
+        set_cache_headers(res);
+        res.result(http::status::no_content);
+      } else {
+        res.result(result.status_);
+        if (result.status_ == http::status::service_unavailable) {
+          res.set(http::field::retry_after, "1");
+        }
       }
+      reply(render_time);
+    };
+
+    if (auto const cached = use_cache ? cache->get(key) : nullptr;
+        cached != nullptr) {
+      write_tile({http::status::ok, cached}, false);
+      return;
+    }
+
+    // set before the render is submitted (-> before finish is called)
+    auto const is_leader = std::make_shared<bool>(false);
+    auto cancel = std::shared_ptr<cancel_token>{};
+    *is_leader = in_flight.join(
+        key,
+        [write_tile, is_leader](tile_result const& result) {
+          write_tile(result, *is_leader);
+        },
+        &cancel);
+    cancel->add_interest();
+    on_disconnect([cancel] { cancel->drop_interest(); });
+    if (!*is_leader) {
+      return;  // same tile is already rendered for another request
     }
 
-    if (!found) {
+    auto render = [&, tile, key, use_cache, cancel](bool expired) {
+      if (expired || cancel->is_cancelled()) {
+        in_flight.finish(key, {http::status::service_unavailable, nullptr});
+        return;
+      }
+
+      auto const render_start = std::chrono::steady_clock::now();
+      if (opt.render_budget_ != 0) {
+        cancel->deadline_ =
+            render_start + std::chrono::milliseconds{opt.render_budget_};
+      }
+      auto result = tile_result{http::status::internal_server_error, nullptr};
       try {
-        auto const mem = tiles_server_res::get_resource(fname);
-        res.body() =
-            std::string{reinterpret_cast<char const*>(mem.ptr_), mem.size_};
-        found = true;
-      } catch (std::out_of_range const&) {
-        // tough luck
+        auto const txn = txn_pool.acquire();
+        auto const render_tile = [&](auto& pc) {
+          return get_tile(handle, txn->txn_, txn->features_cursor_,
+                          pack_handle, render_ctx, tile, pc, *cancel);
+        };
+
+        auto rendered_tile = std::optional<std::string>{};
+        if (opt.perf_log_) {
+          perf_counter pc;
+          rendered_tile = render_tile(pc);
+          perf_report_get_tile(pc);
+          metrics.add(pc);
+        } else {
+          metrics_perf_counter pc{metrics};
+          rendered_tile = render_tile(pc);
+        }
+
+        result = {http::status::ok,
+                  std::make_shared<std::string const>(
+                      rendered_tile ? std::move(*rendered_tile)
+                                    : std::string{}),
+                  std::chrono::steady_clock::now() - render_start};
+        if (use_cache) {
+          cache->put(key, result.data_);
+        }
+      } catch (render_cancelled const&) {
+        result = {http::status::service_unavailable, nullptr};
+      } catch (std::exception const& e) {
+        t_log("render error: {} [tile={}]", e.what(), fmt::streamed(tile));
       }
+      in_flight.finish(key, result);
+    };
+
+    auto const deadline = render_pool::clock_t::now() +
+                          std::chrono::milliseconds{opt.render_timeout_};
+    if (!pool.submit(deadline, std::move(render))) {
+      in_flight.finish(key, {http::status::service_unavailable, nullptr});
     }
+  };
 
-    if (found) {
-      res.result(http::status::ok);
-      if (boost::algorithm::ends_with(fname, ".html")) {
-        res.set(http::field::content_type, "text/html");
-      } else if (boost::algorithm::ends_with(fname, ".css")) {
-        res.set(http::field::content_type, "text/css");
-      } else if (boost::algorithm::ends_with(fname, ".js")) {
-        res.set(http::field::content_type, "text/javascript");
+  // replies on its own (asynchronously)
+  auto const serve_batch = [&](auto const& req, auto& res,
+                               geo::tile const root, uint32_t const depth,
+                               log_reply_fn_t const& reply,
+                               on_disconnect_fn_t const& on_disconnect) {
+    if (depth > kMaxBatchDepth || root.z_ + depth > kMaxZoomLevel ||
+        root.x_ >= (1U << root.z_) || root.y_ >= (1U << root.z_)) {
+      res.result(http::status::bad_request);
+      reply({});
+      return;
+    }
+
+    auto batch_compressor = std::string{};
+    for (auto z = root.z_; z <= root.z_ + depth; ++z) {
+      batch_compressor.append(z == root.z_ ? "" : ".");
+      batch_compressor.append(compressor_tags.at(z));
+    }
+    auto const etag = make_tile_etag(
+        build_id, root, fmt::format("batch{}", depth), batch_compressor);
+    auto const max_age = get_zoom_band_value(max_age_bands, root.z_ + depth);
+    res.set(http::field::etag, etag);
+    if (max_age) {
+      res.set(http::field::cache_control,
+              fmt::format("public, max-age={}", *max_age));
+    }
+    if (etag_matches(req[http::field::if_none_match], etag)) {
+      res.result(http::status::not_modified);
+      reply({});
+      return;
+    }
+
+    auto const cancel = std::make_shared<cancel_token>();
+    cancel->add_interest();
+    on_disconnect([cancel] { cancel->drop_interest(); });
+
+    auto render = [&, root, depth, cancel, reply](bool expired) {
+      if (expired || cancel->is_cancelled()) {
+        res.result(http::status::service_unavailable);
+        res.set(http::field::retry_after, "1");
+        reply({});
+        return;
+      }
+
+      auto const render_start = std::chrono::steady_clock::now();
+      if (opt.render_budget_ != 0) {
+        cancel->deadline_ =
+            render_start + std::chrono::milliseconds{opt.render_budget_};
       }
+      auto render_time = std::chrono::nanoseconds{0};
+      try {
+        auto const tiles = batch_tiles(root, depth);
+        auto const use_cache = [&](geo::tile const& tile) {
+          return cache != nullptr &&
+                 static_cast<int>(tile.z_) >
+                     render_ctx.max_prepared_zoom_level_;
+        };
+
+        // cached tiles are taken as is, all others rendered together
+        std::vector<tile_cache::value_t> data(tiles.size());
+        std::vector<geo::tile> missing;
+        std::vector<size_t> missing_idx;
+        for (auto i = 0U; i < tiles.size(); ++i) {
+          if (use_cache(tiles[i])) {
+            data[i] = cache->get(tile_to_key(tiles[i]));
+          }
+          if (data[i] == nullptr) {
+            missing.emplace_back(tiles[i]);
+            missing_idx.emplace_back(i);
+          }
+        }
+
+        auto const txn = txn_pool.acquire();
+        metrics_perf_counter pc{metrics};
+        auto next = size_t{0};
+        get_tiles(
+            handle, txn->txn_, txn->features_cursor_, pack_handle, render_ctx,
+            root, missing,
+            [&](geo::tile const& tile, std::optional<std::string> rendered) {
+              auto& d = data[missing_idx[next++]];
+              d = std::make_shared<std::string const>(
+                  rendered ? std::move(*rendered) : std::string{});
+              if (use_cache(tile)) {
+                cache->put(tile_to_key(tile), d);
+              }
+            },
+            pc, *cancel);
+
+        std::string buf;
+        for (auto i = 0U; i < tiles.size(); ++i) {
+          append_tile_frame(buf, tiles[i], *data[i]);
+        }
+
+        render_time = std::chrono::steady_clock::now() - render_start;
+        res.body().assign(std::move(buf));
+        res.set(http::field::content_type, "application/octet-stream");
+        if (opt.server_timing_) {
+          res.set("Server-Timing",
+                  fmt::format("render;dur={:.3f}", render_time.count() / 1e6));
+        }
+        res.result(http::status::ok);
+      } catch (render_cancelled const&) {
+        res.result(http::status::service_unavailable);
+        res.set(http::field::retry_after, "1");
+      } catch (std::exception const& e) {
+        t_log("render error: {} [batch={} depth={}]", e.what(),
+              fmt::streamed(root), depth);
+        res.result(http::status::internal_server_error);
+      }
+      reply(render_time);
+    };
+
+    auto const deadline = render_pool::clock_t::now() +
+                          std::chrono::milliseconds{opt.render_timeout_};
+    if (!pool.submit(deadline, std::move(render))) {
+      res.result(http::status::service_unavailable);
+      res.set(http::field::retry_after, "1");
+      reply({});
+    }
+  };
+
+  auto const serve_static = [&](auto const& req, auto& res,
+                                static_resource const& r) {
+    auto const opt_encoding =
+        r.gzip_.empty()
+            ? std::optional{content_encoding::identity}
+            : negotiate_encoding(
+                  req[http::field::accept_encoding],
+                  {content_encoding::gzip, content_encoding::identity});
+    if (!r.gzip_.empty()) {
+      res.set(http::field::vary, "Accept-Encoding");
+    }
+    if (!opt_encoding) {
+      res.result(http::status::not_acceptable);
+      return;
+    }
+
+    auto const gzip = *opt_encoding == content_encoding::gzip;
+    auto const& etag = gzip ? r.gzip_etag_ : r.etag_;
+    res.set(http::field::etag, etag);
+    if (etag_matches(req[http::field::if_none_match], etag)) {
+      res.result(http::status::not_modified);
+      return;
+    }
+
+    // the resource tables outlive all connections: no owner needed
+    res.result(http::status::ok);
+    res.set(http::field::content_type, r.content_type_);
+    if (gzip) {
+      res.set(http::field::content_encoding, "gzip");
+      res.body().assign(r.gzip_, nullptr);
     } else {
-      res.result(http::status::not_found);
+      res.body().assign(r.identity_, nullptr);
     }
+  };
 
-    return true;
+  auto const serve_resource = [&](auto const& req, auto& res,
+                                  static_resources& resources,
+                                  std::string_view const name) {
+    if (auto const* r = resources.find(name); r != nullptr) {
+      serve_static(req, res, *r);
+    } else {
+      res.result(http::status::not_found);
+    }
   };
 
-  serve_forever("0.0.0.0", opt.port_, [&](auto const& req, auto& res) {
+  serve_forever(iocs, http_opt, [&](auto const& req, auto& res,
+                                   reply_fn_t reply_and_write,
+                                   on_disconnect_fn_t const& on_disconnect) {
+    // request and response stay valid until the response is written
+    log_reply_fn_t const reply = [&,
+                                  reply_and_write = std::move(reply_and_write),
+                                  start = std::chrono::steady_clock::now()](
+                                     std::chrono::nanoseconds const render) {
+      access_log_entry e;
+      e.time_ = std::chrono::system_clock::now();
+      e.method_ = http::to_string(req.method());
+      e.set_target(req.target());
+      e.status_ = static_cast<uint16_t>(res.result_int());
+      e.bytes_ = res.body().size();
+      e.total_ns_ = static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count());
+      e.render_ns_ = static_cast<uint64_t>(render.count());
+      access_log.log(e);
+
+      reply_and_write();
+    };
+
     res.set(http::field::access_control_allow_origin, "*");
     res.set(http::field::access_control_allow_headers,
             "X-Requested-With, Content-Type, Accept, Authorization");
     res.set(http::field::access_control_allow_methods,
             "GET, POST, PUT, DELETE, OPTIONS, HEAD");
 
-    switch (req.method()) {
-      case http::verb::options: res.result(http::status::no_content); break;
-      case http::verb::get:
-      case http::verb::head:
-        if (!(maybe_serve_tile(req, res) ||  //
-              maybe_serve_glyphs(req, res) ||  //
-              maybe_serve_file(req, res))) {
-          res.result(http::status::not_found);
-        }
+    if (req.method() == http::verb::options) {
+      res.result(http::status::no_content);
+      reply({});
+      return;
+    } else if (req.method() != http::verb::get &&
+               req.method() != http::verb::head) {
+      res.result(http::status::method_not_allowed);
+      reply({});
+      return;
+    }
+
+    url_buffer_t url_buf;
+    auto const route = route_request(req.target(), url_buf);
+    switch (route.endpoint_) {
+      case endpoint::tile:
+        serve_tile(req, res, route.tile_, reply, on_disconnect);
+        return;
+      case endpoint::batch:
+        serve_batch(req, res, route.tile_, route.depth_, reply, on_disconnect);
+        return;
+      case endpoint::metrics: serve_metrics(res); break;
+      case endpoint::glyphs:
+        serve_resource(req, res, glyph_resources, route.name_);
+        break;
+      case endpoint::file:
+        serve_resource(req, res, file_resources, route.name_);
         break;
-      default: res.result(http::status::method_not_allowed);
+      case endpoint::bad_request: res.result(http::status::bad_request); break;
     }
+    reply({});
   });
 
   return 0;
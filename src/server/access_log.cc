@@ -0,0 +1,106 @@
+#include "tiles/server/access_log.h"
+
+#include <algorithm>
+#include <iterator>
+#include <ostream>
+#include <string>
+
+#include "fmt/chrono.h"
+#include "fmt/core.h"
+
+namespace tiles {
+
+void access_log_entry::set_target(std::string_view const target) {
+  target_size_ = static_cast<uint8_t>(std::min(target.size(), target_.size()));
+  std::copy_n(target.data(), target_size_, target_.data());
+}
+
+access_logger::access_logger(access_log_settings settings, std::ostream& out)
+    : settings_{settings},
+      out_{out},
+      ring_{settings.queue_size_},
+      thread_{[this] { run(); }} {}
+
+access_logger::~access_logger() {
+  stop_ = true;
+  thread_.join();
+}
+
+void access_logger::log(access_log_entry const& entry) {
+  if (!admit(entry) || !ring_.try_push(entry)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+bool access_logger::admit(access_log_entry const& entry) {
+  if (settings_.sample_every_ == 0) {
+    return false;
+  }
+
+  auto const seq = sample_seq_.fetch_add(1, std::memory_order_relaxed);
+  if (entry.status_ < 500 && seq % settings_.sample_every_ != 0) {
+    return false;
+  }
+
+  if (settings_.max_lines_per_second_ == 0) {
+    return true;
+  }
+
+  // fixed one second windows (approximate under contention, never blocks)
+  auto const window = std::chrono::duration_cast<std::chrono::seconds>(
+                          entry.time_.time_since_epoch())
+                          .count();
+  auto curr = rate_window_.load(std::memory_order_relaxed);
+  if (curr != window &&
+      rate_window_.compare_exchange_strong(curr, window,
+                                           std::memory_order_relaxed)) {
+    rate_window_count_.store(0, std::memory_order_relaxed);
+  }
+  return rate_window_count_.fetch_add(1, std::memory_order_relaxed) <
+         settings_.max_lines_per_second_;
+}
+
+void access_logger::run() {
+  std::string buf;
+  auto reported_dropped = uint64_t{0};
+
+  auto const drain = [&] {
+    access_log_entry e;
+    while (ring_.try_pop(e)) {
+      fmt::format_to(
+          std::back_inserter(buf),
+          "{:%FT%TZ} access method={} target={} status={} bytes={} "
+          "total_ms={:.3f}",
+          std::chrono::floor<std::chrono::seconds>(e.time_), e.method_,
+          e.target(), e.status_, e.bytes_, e.total_ns_ / 1e6);
+      if (e.render_ns_ != 0) {
+        fmt::format_to(std::back_inserter(buf), " render_ms={:.3f}",
+                       e.render_ns_ / 1e6);
+      }
+      buf.push_back('\n');
+    }
+
+    if (auto const d = dropped(); d != reported_dropped) {
+      fmt::format_to(std::back_inserter(buf), "access log: {} lines dropped\n",
+                     d - reported_dropped);
+      reported_dropped = d;
+    }
+  };
+
+  while (!stop_) {
+    drain();
+    if (buf.empty()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+      continue;
+    }
+    out_.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    out_.flush();
+    buf.clear();
+  }
+
+  drain();
+  out_.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+  out_.flush();
+}
+
+}  // namespace tiles
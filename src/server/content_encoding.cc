@@ -0,0 +1,167 @@
+#include "tiles/server/content_encoding.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+
+#include "utl/verify.h"
+
+#include "tiles/util.h"
+
+namespace tiles {
+
+std::string_view encoding_name(content_encoding const e) {
+  switch (e) {
+    case content_encoding::deflate: return "deflate";
+    case content_encoding::gzip: return "gzip";
+    case content_encoding::identity: return "";
+    default: throw utl::fail("encoding_name: unknown encoding");
+  }
+}
+
+namespace {
+
+std::string_view trim(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+  return a.size() == b.size() &&
+         std::equal(begin(a), end(a), begin(b), [](char x, char y) {
+           return std::tolower(static_cast<unsigned char>(x)) ==
+                  std::tolower(static_cast<unsigned char>(y));
+         });
+}
+
+// qvalue = ( "0" [ "." 0*3DIGIT ] ) / ( "1" [ "." 0*3("0") ] ), in 1/1000
+int parse_qvalue(std::string_view params) {
+  while (!params.empty()) {
+    auto const pos = params.find(';');
+    auto const param = trim(params.substr(0, pos));
+    if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') &&
+        param[1] == '=') {
+      auto const value = param.substr(2);
+      auto const dot = value.find('.');
+      auto q = 0;
+      std::from_chars(value.data(), value.data() + value.substr(0, dot).size(),
+                      q);
+      q *= 1000;
+      if (dot != std::string_view::npos) {
+        auto const fraction = value.substr(dot + 1, 3);
+        auto f = 0;
+        std::from_chars(fraction.data(), fraction.data() + fraction.size(), f);
+        for (auto i = fraction.size(); i < 3; ++i) {
+          f *= 10;
+        }
+        q += f;
+      }
+      return std::clamp(q, 0, 1000);
+    }
+    if (pos == std::string_view::npos) {
+      break;
+    }
+    params.remove_prefix(pos + 1);
+  }
+  return 1000;
+}
+
+}  // namespace
+
+std::optional<content_encoding> negotiate_encoding(
+    std::string_view accept_encoding) {
+  return negotiate_encoding(
+      accept_encoding, {content_encoding::deflate, content_encoding::gzip,
+                        content_encoding::identity});
+}
+
+std::optional<content_encoding> negotiate_encoding(
+    std::string_view accept_encoding,
+    std::initializer_list<content_encoding> available) {
+  constexpr auto const kEncodings =
+      std::array{content_encoding::deflate, content_encoding::gzip,
+                 content_encoding::identity};
+  constexpr auto const kTokens =
+      std::array<std::string_view, kEncodings.size()>{"deflate", "gzip",
+                                                      "identity"};
+
+  // -1 = not mentioned
+  std::array<int, kEncodings.size()> q{-1, -1, -1};
+  auto q_any = -1;
+
+  auto const is_available = [&](content_encoding const e) {
+    return std::find(begin(available), end(available), e) != end(available);
+  };
+
+  accept_encoding = trim(accept_encoding);
+  if (accept_encoding.empty()) {
+    return is_available(content_encoding::identity)
+               ? std::optional{content_encoding::identity}
+               : std::nullopt;
+  }
+
+  while (!accept_encoding.empty()) {
+    auto const pos = accept_encoding.find(',');
+    auto const item = trim(accept_encoding.substr(0, pos));
+
+    auto const semicolon = item.find(';');
+    auto const coding = trim(item.substr(0, semicolon));
+    auto const qvalue =
+        semicolon == std::string_view::npos
+            ? 1000
+            : parse_qvalue(item.substr(semicolon + 1));
+
+    if (coding == "*") {
+      q_any = qvalue;
+    } else {
+      for (auto i = 0U; i < kEncodings.size(); ++i) {
+        if (iequals(coding, kTokens[i]) ||
+            (kEncodings[i] == content_encoding::gzip &&
+             iequals(coding, "x-gzip"))) {
+          q[i] = std::max(q[i], qvalue);
+        }
+      }
+    }
+
+    if (pos == std::string_view::npos) {
+      break;
+    }
+    accept_encoding.remove_prefix(pos + 1);
+  }
+
+  std::optional<content_encoding> best;
+  auto best_q = 0;
+  for (auto i = 0U; i < kEncodings.size(); ++i) {
+    if (!is_available(kEncodings[i])) {
+      continue;
+    }
+
+    auto effective = q[i] != -1 ? q[i] : q_any;
+    if (effective == -1) {
+      // identity is acceptable unless excluded explicitly (RFC 7231 5.3.4)
+      effective = kEncodings[i] == content_encoding::identity ? 1 : 0;
+    }
+    if (effective > best_q) {
+      best = kEncodings[i];
+      best_q = effective;
+    }
+  }
+  return best;
+}
+
+std::string encode_tile(content_encoding const e, std::string_view deflated) {
+  switch (e) {
+    case content_encoding::deflate: return std::string{deflated};
+    case content_encoding::gzip: return deflate_to_gzip(deflated);
+    case content_encoding::identity: return decompress_deflate(deflated);
+    default: throw utl::fail("encode_tile: unknown encoding");
+  }
+}
+
+}  // namespace tiles
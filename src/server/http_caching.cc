@@ -0,0 +1,56 @@
+#include "tiles/server/http_caching.h"
+
+#include "fmt/core.h"
+
+#include "tiles/util.h"
+
+namespace tiles {
+
+std::string make_tile_etag(std::string_view build_id, geo::tile const& tile,
+                           std::string_view variant,
+                           std::string_view compressor) {
+  auto etag = fmt::format("\"{}-{}-{}-{}", build_id, tile.z_, tile.x_, tile.y_);
+  for (auto const part : {variant, compressor}) {
+    if (!part.empty()) {
+      etag.push_back('-');
+      etag.append(part);
+    }
+  }
+  etag.push_back('"');
+  return etag;
+}
+
+std::string make_compressor_tag(int const level) {
+  return fmt::format("{}{}", compression_backend(), level);
+}
+
+bool etag_matches(std::string_view if_none_match, std::string_view etag) {
+  auto const trim = [](std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+      s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+      s.remove_suffix(1);
+    }
+    return s;
+  };
+  auto const strip_weak = [](std::string_view s) {
+    return s.substr(0, 2) == "W/" ? s.substr(2) : s;
+  };
+
+  etag = strip_weak(etag);
+  while (!if_none_match.empty()) {
+    auto const pos = if_none_match.find(',');
+    auto const candidate = trim(if_none_match.substr(0, pos));
+    if (candidate == "*" || strip_weak(candidate) == etag) {
+      return true;
+    }
+    if (pos == std::string_view::npos) {
+      break;
+    }
+    if_none_match.remove_prefix(pos + 1);
+  }
+  return false;
+}
+
+}  // namespace tiles
@@ -0,0 +1,154 @@
+#include "tiles/server/perf_metrics.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+#include "fmt/core.h"
+
+namespace tiles {
+
+void perf_histogram_snapshot::merge(perf_histogram const& o) {
+  for (auto i = 0U; i < buckets_.size(); ++i) {
+    buckets_[i] += o.buckets_[i].load(std::memory_order_relaxed);
+  }
+  sum_ += o.sum_.load(std::memory_order_relaxed);
+}
+
+void perf_histogram_snapshot::merge(perf_histogram_snapshot const& o) {
+  for (auto i = 0U; i < buckets_.size(); ++i) {
+    buckets_[i] += o.buckets_[i];
+  }
+  sum_ += o.sum_;
+}
+
+uint64_t perf_histogram_snapshot::count() const {
+  return std::accumulate(begin(buckets_), end(buckets_), uint64_t{0});
+}
+
+namespace {
+
+std::atomic_uint64_t next_perf_metrics_id{0};
+
+}  // namespace
+
+perf_metrics::perf_metrics() : id_{next_perf_metrics_id++} {}
+
+perf_histograms& perf_metrics::local() {
+  // the server has one perf_metrics instance: only the first lookup of a
+  // thread takes the lock (ids are never reused). with several instances,
+  // switching between them looks up the existing histograms of the thread.
+  thread_local std::pair<uint64_t, perf_histograms*> cached{
+      std::numeric_limits<uint64_t>::max(), nullptr};
+  if (cached.first == id_) {
+    return *cached.second;
+  }
+
+  auto const thread_id = std::this_thread::get_id();
+  std::lock_guard<std::mutex> l{mutex_};
+  auto it = std::find_if(begin(threads_), end(threads_), [&](auto const& t) {
+    return t.first == thread_id;
+  });
+  if (it == end(threads_)) {
+    threads_.emplace_back(thread_id, std::make_unique<perf_histograms>());
+    it = std::prev(end(threads_));
+  }
+  cached = {id_, it->second.get()};
+  return *it->second;
+}
+
+void perf_metrics::add(perf_counter const& pc) {
+  auto& histograms = local();
+  for (auto task = 0U; task < perf_task::SIZE; ++task) {
+    for (auto const value : pc.finished_[task]) {
+      histograms[task].record(value);
+    }
+  }
+}
+
+perf_snapshot perf_metrics::snapshot() const {
+  perf_snapshot result;
+  std::lock_guard<std::mutex> l{mutex_};
+  for (auto const& [thread_id, histograms] : threads_) {
+    for (auto task = 0U; task < perf_task::SIZE; ++task) {
+      result[task].merge((*histograms)[task]);
+    }
+  }
+  return result;
+}
+
+namespace {
+
+enum class perf_unit { ns, bytes, count };
+
+struct perf_task_info {
+  char const* name_;
+  perf_unit unit_;
+};
+
+constexpr auto const kPerfTaskInfos =
+    std::array<perf_task_info, perf_task::SIZE>{{
+    {"tiles_result_size_bytes", perf_unit::bytes},
+    {"tiles_result_allocations", perf_unit::count},
+    {"tiles_get_tile_total_seconds", perf_unit::ns},
+    {"tiles_get_tile_fetch_seconds", perf_unit::ns},
+    {"tiles_get_tile_render_seconds", perf_unit::ns},
+    {"tiles_get_tile_compress_seconds", perf_unit::ns},
+    {"tiles_render_find_seaside_seconds", perf_unit::ns},
+    {"tiles_render_add_seaside_seconds", perf_unit::ns},
+    {"tiles_render_query_feature_seconds", perf_unit::ns},
+    {"tiles_render_iter_feature_seconds", perf_unit::ns},
+    {"tiles_render_deser_feature_okay_seconds", perf_unit::ns},
+    {"tiles_render_deser_feature_skip_seconds", perf_unit::ns},
+    {"tiles_render_add_feature_seconds", perf_unit::ns},
+    {"tiles_render_finish_seconds", perf_unit::ns},
+}};
+
+// exposed bucket range [first, last] (everything else only in "+Inf")
+std::pair<unsigned, unsigned> bucket_range(perf_unit const unit) {
+  switch (unit) {
+    case perf_unit::ns: return {10U, 34U};  // ~1us .. ~17s
+    case perf_unit::bytes: return {6U, 26U};  // 64B .. 64MB
+    case perf_unit::count: return {0U, 20U};  // 1 .. ~1M
+  }
+  return {0U, 0U};
+}
+
+double to_base_unit(perf_unit const unit, double const value) {
+  return unit == perf_unit::ns ? value / 1e9 : value;
+}
+
+}  // namespace
+
+void append_prometheus_metrics(std::string& buf, perf_snapshot const& s) {
+  auto out = std::back_inserter(buf);
+  for (auto task = 0U; task < perf_task::SIZE; ++task) {
+    auto const& info = kPerfTaskInfos[task];
+    auto const& h = s[task];
+    auto const [first, last] = bucket_range(info.unit_);
+
+    fmt::format_to(out, "# TYPE {} histogram\n", info.name_);
+
+    auto cumulative = uint64_t{0};
+    for (auto i = 0U; i <= last; ++i) {
+      cumulative += h.buckets_[i];
+      if (i >= first) {
+        // bucket i: value < 2^i <=> value <= 2^i - 1 (integer samples)
+        fmt::format_to(
+            out, "{}_bucket{{le=\"{}\"}} {}\n", info.name_,
+            to_base_unit(info.unit_, static_cast<double>((1ULL << i) - 1)),
+            cumulative);
+      }
+    }
+
+    auto const count = h.count();
+    fmt::format_to(out, "{}_bucket{{le=\"+Inf\"}} {}\n", info.name_, count);
+    fmt::format_to(out, "{}_sum {}\n", info.name_,
+                   to_base_unit(info.unit_, static_cast<double>(h.sum_)));
+    fmt::format_to(out, "{}_count {}\n", info.name_, count);
+  }
+}
+
+}  // namespace tiles
@@ -0,0 +1,74 @@
+#include "tiles/server/render_pool.h"
+
+#include <algorithm>
+
+#include "utl/verify.h"
+
+#include "tiles/util.h"
+
+namespace tiles {
+
+render_pool::render_pool(size_t const thread_count,
+                         size_t const max_queue_size)
+    : max_queue_size_{max_queue_size} {
+  utl::verify(thread_count != 0, "render_pool: need at least one thread");
+  threads_.reserve(thread_count);
+  for (auto i = 0ULL; i < thread_count; ++i) {
+    threads_.emplace_back([this] { run(); });
+  }
+}
+
+render_pool::~render_pool() {
+  {
+    std::lock_guard<std::mutex> l{mutex_};
+    stop_ = true;
+  }
+  cv_.notify_all();
+  std::for_each(begin(threads_), end(threads_), [](auto& t) { t.join(); });
+
+  for (auto& [deadline, task] : queue_) {
+    task(true);  // release whatever the task holds (e.g. connections)
+  }
+}
+
+bool render_pool::submit(clock_t::time_point const deadline, task_t task) {
+  {
+    std::lock_guard<std::mutex> l{mutex_};
+    if (stop_ || queue_.size() >= max_queue_size_) {
+      return false;
+    }
+    queue_.emplace_back(deadline, std::move(task));
+  }
+  cv_.notify_one();
+  return true;
+}
+
+size_t render_pool::queue_size() const {
+  std::lock_guard<std::mutex> l{mutex_};
+  return queue_.size();
+}
+
+void render_pool::run() {
+  while (true) {
+    std::pair<clock_t::time_point, task_t> next;
+    {
+      std::unique_lock<std::mutex> l{mutex_};
+      cv_.wait(l, [&] { return stop_ || !queue_.empty(); });
+      if (stop_) {
+        return;
+      }
+      next = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    try {
+      next.second(clock_t::now() > next.first);
+    } catch (std::exception const& e) {
+      t_log("render_pool: unhandled error: {}", e.what());
+    } catch (...) {
+      t_log("render_pool: unhandled unknown error");
+    }
+  }
+}
+
+}  // namespace tiles
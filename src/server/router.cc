@@ -0,0 +1,111 @@
+#include "tiles/server/router.h"
+
+#include <array>
+#include <charconv>
+#include <optional>
+
+#include "tiles/parse_tile_url.h"
+
+namespace tiles {
+
+namespace {
+
+int hex_value(char const c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// percent and '+' decoding, nullopt if invalid or too long
+std::optional<std::string_view> url_decode(std::string_view const in,
+                                           url_buffer_t& buf) {
+  auto size = size_t{0};
+  for (auto i = size_t{0}; i < in.size(); ++i) {
+    if (size == buf.size()) {
+      return std::nullopt;
+    }
+
+    if (in[i] == '%') {
+      if (i + 2 >= in.size()) {
+        return std::nullopt;
+      }
+      auto const hi = hex_value(in[i + 1]);
+      auto const lo = hex_value(in[i + 2]);
+      if (hi == -1 || lo == -1) {
+        return std::nullopt;
+      }
+      buf[size++] = static_cast<char>(hi * 16 + lo);
+      i += 2;
+    } else if (in[i] == '+') {
+      buf[size++] = ' ';
+    } else {
+      buf[size++] = in[i];
+    }
+  }
+  return std::string_view{buf.data(), size};
+}
+
+// "{a}/{b}/.../{n}" (exactly N numbers)
+template <size_t N>
+std::optional<std::array<uint32_t, N>> parse_numbers(std::string_view s) {
+  std::array<uint32_t, N> numbers{};
+  for (auto i = 0U; i < N; ++i) {
+    auto const [ptr, ec] =
+        std::from_chars(s.data(), s.data() + s.size(), numbers[i]);
+    if (ec != std::errc{} || ptr == s.data()) {
+      return std::nullopt;
+    }
+    s.remove_prefix(static_cast<size_t>(ptr - s.data()));
+    if (i + 1 != N) {
+      if (!s.starts_with('/')) {
+        return std::nullopt;
+      }
+      s.remove_prefix(1);
+    }
+  }
+  return s.empty() ? std::optional{numbers} : std::nullopt;
+}
+
+}  // namespace
+
+route route_request(std::string_view target, url_buffer_t& buf) {
+  target = target.substr(0, target.find('?'));
+
+  auto const opt_path = url_decode(target, buf);
+  if (!opt_path || !opt_path->starts_with('/')) {
+    return {};
+  }
+  auto const path = *opt_path;
+
+  if (auto const tile = parse_tile_url(path); tile) {
+    return {endpoint::tile, *tile, 0U, {}};
+  }
+
+  constexpr auto const kBatchPrefix = std::string_view{"/batch/"};
+  if (path.starts_with(kBatchPrefix)) {
+    if (auto const n = parse_numbers<4>(path.substr(kBatchPrefix.size())); n) {
+      auto const [depth, z, x, y] = *n;
+      return {endpoint::batch, geo::tile{x, y, z}, depth, {}};
+    }
+    return {};
+  }
+
+  if (path == "/metrics") {
+    return {endpoint::metrics, {}, 0U, {}};
+  }
+
+  constexpr auto const kGlyphsPrefix = std::string_view{"/glyphs/"};
+  if (path.size() > kGlyphsPrefix.size() && path.starts_with(kGlyphsPrefix)) {
+    return {endpoint::glyphs, {}, 0U, path.substr(kGlyphsPrefix.size())};
+  }
+
+  return {endpoint::file, {}, 0U,
+          path == "/" ? "index.html" : path.substr(1)};
+}
+
+}  // namespace tiles
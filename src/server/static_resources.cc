@@ -0,0 +1,139 @@
+#include "tiles/server/static_resources.h"
+
+#include <array>
+#include <mutex>
+#include <utility>
+
+#include "fmt/core.h"
+
+#include "utl/parser/mmap_reader.h"
+#include "utl/verify.h"
+
+#include "tiles/util.h"
+
+namespace tiles {
+
+std::string_view guess_content_type(std::string_view const name) {
+  constexpr auto const kContentTypes =
+      std::array<std::pair<std::string_view, std::string_view>, 10>{{
+          {".html", "text/html"},
+          {".css", "text/css"},
+          {".js", "text/javascript"},
+          {".json", "application/json"},
+          {".pbf", "application/x-protobuf"},
+          {".svg", "image/svg+xml"},
+          {".png", "image/png"},
+          {".jpg", "image/jpeg"},
+          {".ico", "image/x-icon"},
+          {".txt", "text/plain"},
+      }};
+
+  for (auto const& [extension, content_type] : kContentTypes) {
+    if (name.ends_with(extension)) {
+      return content_type;
+    }
+  }
+  return "application/octet-stream";
+}
+
+bool is_compressible(std::string_view const content_type) {
+  return content_type.starts_with("text/") ||
+         content_type == "application/json" ||
+         content_type == "application/x-protobuf" ||
+         content_type == "image/svg+xml";
+}
+
+namespace {
+
+constexpr auto const kMinGzipSize = 256U;
+
+uint64_t fnv1a(std::string_view const s) {
+  auto hash = uint64_t{14695981039346656037ULL};
+  for (auto const c : s) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= uint64_t{1099511628211ULL};
+  }
+  return hash;
+}
+
+void finish_static_resource(static_resource& r, std::string_view const name,
+                            std::string_view const content) {
+  r.content_type_ = guess_content_type(name);
+  auto const hash = fnv1a(content);
+  r.etag_ = fmt::format("\"{:016x}-{:x}\"", hash, content.size());
+  r.gzip_etag_ = fmt::format("\"{:016x}-{:x}-gzip\"", hash, content.size());
+  r.identity_ = content;
+
+  if (is_compressible(r.content_type_) && content.size() >= kMinGzipSize) {
+    auto gzip = deflate_to_gzip(compress_deflate(std::string{content}));
+    if (gzip.size() < content.size()) {
+      r.gzip_ = std::move(gzip);
+    }
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<static_resource> make_static_resource(std::string_view name,
+                                                      std::string content) {
+  auto r = std::make_unique<static_resource>();
+  r->storage_ = std::move(content);
+  finish_static_resource(*r, name, r->storage_);
+  return r;
+}
+
+std::unique_ptr<static_resource> make_static_resource(
+    std::string_view name, std::string_view static_content) {
+  auto r = std::make_unique<static_resource>();
+  finish_static_resource(*r, name, static_content);
+  return r;
+}
+
+void static_resources::add_directory(std::filesystem::path const& root) {
+  utl::verify(std::filesystem::is_directory(root),
+              "static_resources: {} is not a directory", root.string());
+
+  for (auto const& entry :
+       std::filesystem::recursive_directory_iterator{root}) {
+    if (!entry.is_regular_file()) {
+      continue;
+    }
+
+    auto const name =
+        std::filesystem::relative(entry.path(), root).generic_string();
+    auto const mem = utl::mmap_reader{entry.path().string().c_str()};
+    files_[name] = make_static_resource(
+        name, std::string{mem.m_.ptr(), mem.m_.size()});
+  }
+}
+
+static_resource const* static_resources::find(std::string_view const name) {
+  if (auto const it = files_.find(name); it != end(files_)) {
+    return it->second.get();
+  }
+
+  if (!fallback_) {
+    return nullptr;
+  }
+
+  {
+    std::shared_lock<std::shared_mutex> l{fallback_mutex_};
+    if (auto const it = fallback_files_.find(name);
+        it != end(fallback_files_)) {
+      return it->second.get();
+    }
+  }
+
+  auto const content = fallback_(std::string{name});
+  if (!content) {
+    return nullptr;  // unknown names are not remembered (unbounded)
+  }
+
+  // compress outside the lock: a concurrent duplicate is simply dropped
+  auto r = make_static_resource(name, *content);
+  std::unique_lock<std::shared_mutex> l{fallback_mutex_};
+  return fallback_files_.emplace(std::string{name}, std::move(r))
+      .first->second.get();
+}
+
+}  // namespace tiles
@@ -0,0 +1,57 @@
+#include "tiles/server/tile_batch.h"
+
+#include <array>
+#include <cstdint>
+
+#include "utl/verify.h"
+
+#include "tiles/bin_utils.h"
+
+namespace tiles {
+
+std::vector<geo::tile> batch_tiles(geo::tile const& root,
+                                   unsigned const depth) {
+  utl::verify(depth <= kMaxBatchDepth, "batch_tiles: depth {} too large",
+              depth);
+  auto const bounds = root.bounds_on_z(root.z_ + depth);
+
+  std::vector<geo::tile> tiles;
+  tiles.reserve(1ULL << (2 * depth));
+  for (auto y = bounds.miny_; y < bounds.maxy_; ++y) {
+    for (auto x = bounds.minx_; x < bounds.maxx_; ++x) {
+      tiles.emplace_back(x, y, root.z_ + depth);
+    }
+  }
+  return tiles;
+}
+
+void append_tile_frame(std::string& buf, geo::tile const& tile,
+                       std::string_view const data) {
+  for (auto const value : {tile.z_, tile.x_, tile.y_,
+                           static_cast<uint32_t>(data.size())}) {
+    append<uint32_t>(buf, value);
+  }
+  buf.append(data);
+}
+
+std::vector<std::pair<geo::tile, std::string_view>> parse_tile_frames(
+    std::string_view buf) {
+  constexpr auto const kHeaderSize = 4 * sizeof(uint32_t);
+
+  std::vector<std::pair<geo::tile, std::string_view>> frames;
+  while (!buf.empty()) {
+    utl::verify(buf.size() >= kHeaderSize, "parse_tile_frames: truncated");
+    auto const z = read<uint32_t>(buf.data(), 0);
+    auto const x = read<uint32_t>(buf.data(), 4);
+    auto const y = read<uint32_t>(buf.data(), 8);
+    auto const size = read<uint32_t>(buf.data(), 12);
+    buf.remove_prefix(kHeaderSize);
+
+    utl::verify(buf.size() >= size, "parse_tile_frames: truncated");
+    frames.emplace_back(geo::tile{x, y, z}, buf.substr(0, size));
+    buf.remove_prefix(size);
+  }
+  return frames;
+}
+
+}  // namespace tiles
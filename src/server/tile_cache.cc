@@ -0,0 +1,152 @@
+#include "tiles/server/tile_cache.h"
+
+#include "utl/verify.h"
+
+namespace tiles {
+
+struct tile_cache::shard {
+  struct slot {
+    tile_key_t key_{0};
+    value_t value_;
+    bool referenced_{false};
+  };
+
+  static size_t entry_size(value_t const& value) {
+    return value->size() + kEntryOverhead;
+  }
+
+  value_t get(tile_key_t const key) {
+    std::lock_guard<std::mutex> l{mutex_};
+    auto const it = index_.find(key);
+    if (it == end(index_)) {
+      return nullptr;
+    }
+    auto& s = slots_[it->second];
+    s.referenced_ = true;
+    return s.value_;
+  }
+
+  // returns the number of evicted entries
+  size_t put(tile_key_t const key, value_t value, size_t const max_bytes) {
+    auto const size = entry_size(value);
+    if (size > max_bytes) {
+      return 0;  // would never fit
+    }
+
+    std::lock_guard<std::mutex> l{mutex_};
+    if (auto const it = index_.find(key); it != end(index_)) {
+      auto& s = slots_[it->second];
+      bytes_ -= entry_size(s.value_);
+      bytes_ += size;
+      s.value_ = std::move(value);
+      s.referenced_ = true;
+      return evict(max_bytes);
+    }
+
+    auto const evicted = evict(max_bytes - size);
+
+    size_t idx = 0;
+    if (free_.empty()) {
+      idx = slots_.size();
+      slots_.emplace_back();
+    } else {
+      idx = free_.back();
+      free_.pop_back();
+    }
+
+    slots_[idx] = slot{key, std::move(value), false};
+    index_.emplace(key, idx);
+    bytes_ += size;
+    return evicted;
+  }
+
+  // CLOCK: sweep the hand over the slots, referenced entries get a second
+  // chance, all others are dropped until the shard fits into the budget.
+  size_t evict(size_t const budget) {
+    size_t evicted = 0;
+    while (bytes_ > budget && !index_.empty()) {
+      if (hand_ >= slots_.size()) {
+        hand_ = 0;
+      }
+
+      auto& s = slots_[hand_];
+      if (s.value_ == nullptr) {  // free slot
+        ++hand_;
+        continue;
+      }
+      if (s.referenced_) {
+        s.referenced_ = false;
+        ++hand_;
+        continue;
+      }
+
+      bytes_ -= entry_size(s.value_);
+      index_.erase(s.key_);
+      s = slot{};
+      free_.push_back(hand_);
+      ++hand_;
+      ++evicted;
+    }
+    return evicted;
+  }
+
+  mutable std::mutex mutex_;
+  std::vector<slot> slots_;
+  std::vector<size_t> free_;
+  std::unordered_map<tile_key_t, size_t> index_;
+  size_t hand_{0};
+  size_t bytes_{0};
+};
+
+tile_cache::tile_cache(size_t const max_bytes, size_t const shard_count)
+    : max_bytes_{max_bytes} {
+  utl::verify(shard_count != 0, "tile_cache: need at least one shard");
+  shards_.reserve(shard_count);
+  for (auto i = 0ULL; i < shard_count; ++i) {
+    shards_.emplace_back(std::make_unique<shard>());
+  }
+}
+
+tile_cache::~tile_cache() = default;
+
+tile_cache::shard& tile_cache::get_shard(tile_key_t const key) {
+  // keys of neighboring tiles differ only in a few bits -> mix them first
+  auto h = key;
+  h ^= h >> 33U;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33U;
+  return *shards_[h % shards_.size()];
+}
+
+tile_cache::value_t tile_cache::get(tile_key_t const key) {
+  auto value = get_shard(key).get(key);
+  if (value == nullptr) {
+    ++misses_;
+  } else {
+    ++hits_;
+  }
+  return value;
+}
+
+void tile_cache::put(tile_key_t const key, value_t value) {
+  utl::verify(value != nullptr, "tile_cache: cannot insert nullptr");
+  evictions_ +=
+      get_shard(key).put(key, std::move(value), max_bytes_ / shards_.size());
+  ++inserts_;
+}
+
+tile_cache::stats tile_cache::get_stats() const {
+  stats s;
+  s.hits_ = hits_;
+  s.misses_ = misses_;
+  s.inserts_ = inserts_;
+  s.evictions_ = evictions_;
+  for (auto const& shard : shards_) {
+    std::lock_guard<std::mutex> l{shard->mutex_};
+    s.entries_ += shard->index_.size();
+    s.bytes_ += shard->bytes_;
+  }
+  return s;
+}
+
+}  // namespace tiles
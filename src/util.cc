@@ -1,7 +1,13 @@
 #include "tiles/util.h"
 
+#include <array>
+#include <memory>
 #include <regex>
 
+#ifdef TILES_LIBDEFLATE
+#include "libdeflate.h"
+#endif
+
 #include "zlib.h"
 
 #include "utl/to_vec.h"
@@ -9,16 +15,123 @@
 
 namespace tiles {
 
-std::string compress_deflate(std::string const& input) {
-  auto out_size = compressBound(input.size());
-  std::string buffer(out_size, '\0');
+namespace {
+
+// worst case sized output buffer, reused by all tiles of a thread:
+// the result is copied out with its exact size
+std::string& compress_scratch(size_t const bound) {
+  thread_local std::string scratch;
+  if (scratch.size() < bound) {
+    scratch.resize(bound);
+  }
+  return scratch;
+}
+
+}  // namespace
+
+#ifdef TILES_LIBDEFLATE
+
+char const* compression_backend() { return "libdeflate"; }
+
+std::string compress_deflate(std::string const& input, int const level) {
+  utl::verify(level >= 0 && level <= kMaxCompressionLevel,
+              "compress_deflate: invalid level {}", level);
+
+  // compressors are expensive to allocate: one per thread and level
+  struct compressor_deleter {
+    void operator()(libdeflate_compressor* c) const {
+      libdeflate_free_compressor(c);
+    }
+  };
+  thread_local std::array<
+      std::unique_ptr<libdeflate_compressor, compressor_deleter>,
+      kMaxCompressionLevel + 1>
+      compressors;
+
+  auto& compressor = compressors[level];
+  if (!compressor) {
+    compressor.reset(libdeflate_alloc_compressor(level));
+    utl::verify(compressor != nullptr, "compress_deflate: alloc failed");
+  }
+
+  auto& buffer = compress_scratch(
+      libdeflate_zlib_compress_bound(compressor.get(), input.size()));
+  auto const out_size =
+      libdeflate_zlib_compress(compressor.get(), input.data(), input.size(),
+                               buffer.data(), buffer.size());
+  utl::verify(out_size != 0, "compress_deflate failed");
+
+  return std::string{buffer.data(), out_size};
+}
+
+#else
+
+char const* compression_backend() { return "zlib"; }
+
+std::string compress_deflate(std::string const& input, int const level) {
+  utl::verify(level >= 0 && level <= kMaxCompressionLevel,
+              "compress_deflate: invalid level {}", level);
+
+  auto& buffer = compress_scratch(compressBound(input.size()));
+  auto out_size = static_cast<uLongf>(buffer.size());
 
   auto error = compress2(reinterpret_cast<uint8_t*>(buffer.data()), &out_size,
                          reinterpret_cast<uint8_t const*>(input.data()),
-                         input.size(), Z_BEST_COMPRESSION);
+                         input.size(), level);
   utl::verify(error == 0, "compress_deflate failed");
 
-  buffer.resize(out_size);
+  return std::string{buffer.data(), out_size};
+}
+
+#endif
+
+std::string decompress_deflate(std::string_view input) {
+  z_stream strm{};
+  utl::verify(inflateInit(&strm) == Z_OK, "decompress_deflate: init failed");
+
+  strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  strm.avail_in = static_cast<uInt>(input.size());
+
+  std::string buffer(input.size() * 4, '\0');
+  auto ret = Z_OK;
+  while (ret == Z_OK) {
+    if (strm.total_out == buffer.size()) {
+      buffer.resize(buffer.size() * 2);
+    }
+    strm.next_out = reinterpret_cast<Bytef*>(buffer.data() + strm.total_out);
+    strm.avail_out = static_cast<uInt>(buffer.size() - strm.total_out);
+    ret = inflate(&strm, Z_NO_FLUSH);
+  }
+  inflateEnd(&strm);
+  utl::verify(ret == Z_STREAM_END, "decompress_deflate failed");
+
+  buffer.resize(strm.total_out);
+  return buffer;
+}
+
+std::string deflate_to_gzip(std::string_view input) {
+  // zlib: 2 byte header (no preset dictionary), data, 4 byte adler32
+  utl::verify(input.size() >= 6 && (input[1] & 0x20) == 0,
+              "deflate_to_gzip: invalid zlib stream");
+
+  auto const raw = decompress_deflate(input);
+  auto const crc = static_cast<uint32_t>(
+      crc32(0, reinterpret_cast<Bytef const*>(raw.data()),
+            static_cast<uInt>(raw.size())));
+  auto const size = static_cast<uint32_t>(raw.size());
+
+  auto const data = input.substr(2, input.size() - 6);
+
+  std::string buffer;
+  buffer.reserve(10 + data.size() + 8);
+  // magic, CM=deflate, no flags, no mtime, no extra flags, OS=unknown
+  buffer.append("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff", 10);
+  buffer.append(data);
+  for (auto const v : {crc, size}) {  // little endian
+    for (auto i = 0; i < 4; ++i) {
+      buffer.push_back(static_cast<char>((v >> (8 * i)) & 0xFFU));
+    }
+  }
   return buffer;
 }
 
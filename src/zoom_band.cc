@@ -0,0 +1,58 @@
+#include "tiles/zoom_band.h"
+
+#include <charconv>
+#include <string_view>
+
+#include "utl/verify.h"
+
+namespace tiles {
+
+std::vector<zoom_band> parse_zoom_bands(std::vector<std::string> const& specs,
+                                        int const min_value,
+                                        int const max_value) {
+  auto const parse_num = [](std::string_view s, auto& out) {
+    auto const [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    utl::verify(ec == std::errc{} && ptr == s.data() + s.size(),
+                "invalid number in zoom band: {}", s);
+  };
+
+  std::vector<zoom_band> bands;
+  for (auto const& spec : specs) {
+    auto const sv = std::string_view{spec};
+    auto const colon = sv.find(':');
+    utl::verify(colon != std::string_view::npos,
+                "zoom band without ':' [spec={}]", spec);
+
+    auto const zooms = sv.substr(0, colon);
+    auto const dash = zooms.find('-');
+
+    zoom_band band{};
+    parse_num(zooms.substr(0, dash), band.min_z_);
+    if (dash == std::string_view::npos) {
+      band.max_z_ = band.min_z_;
+    } else {
+      parse_num(zooms.substr(dash + 1), band.max_z_);
+    }
+    parse_num(sv.substr(colon + 1), band.value_);
+
+    utl::verify(band.min_z_ <= band.max_z_,
+                "zoom band with min_z > max_z [spec={}]", spec);
+    utl::verify(min_value <= band.value_ && band.value_ <= max_value,
+                "zoom band value not in [{}, {}] [spec={}]", min_value,
+                max_value, spec);
+    bands.push_back(band);
+  }
+  return bands;
+}
+
+std::optional<int> get_zoom_band_value(std::vector<zoom_band> const& bands,
+                                       uint32_t const z) {
+  for (auto const& band : bands) {
+    if (band.min_z_ <= z && z <= band.max_z_) {
+      return band.value_;
+    }
+  }
+  return std::nullopt;
+}
+
+}  // namespace tiles
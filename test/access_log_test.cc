@@ -0,0 +1,106 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "tiles/server/access_log.h"
+#include "tiles/server/mpsc_ring.h"
+
+using namespace tiles;
+
+TEST(access_log, mpsc_ring) {
+  EXPECT_ANY_THROW(mpsc_ring<int>{3});
+
+  mpsc_ring<int> ring{4};
+  for (auto i = 0; i < 4; ++i) {
+    EXPECT_TRUE(ring.try_push(i));
+  }
+  EXPECT_FALSE(ring.try_push(4));  // full
+
+  int value = -1;
+  EXPECT_TRUE(ring.try_pop(value));
+  EXPECT_EQ(0, value);
+  EXPECT_TRUE(ring.try_push(4));  // wraps around
+
+  std::vector<int> popped;
+  while (ring.try_pop(value)) {
+    popped.push_back(value);
+  }
+  EXPECT_EQ((std::vector<int>{1, 2, 3, 4}), popped);
+}
+
+TEST(access_log, mpsc_ring_producers) {
+  constexpr auto const kProducers = 4;
+  constexpr auto const kPerProducer = 10000;
+
+  mpsc_ring<int> ring{1024};
+  std::vector<std::thread> producers;
+  for (auto p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&, p] {
+      for (auto i = 0; i < kPerProducer; ++i) {
+        while (!ring.try_push(p * kPerProducer + i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::set<int> seen;
+  int value = 0;
+  while (seen.size() != kProducers * kPerProducer) {
+    if (ring.try_pop(value)) {
+      EXPECT_TRUE(seen.insert(value).second);
+    }
+  }
+  for (auto& t : producers) {
+    t.join();
+  }
+}
+
+TEST(access_log, sample_and_rate_limit) {
+  std::ostringstream out;
+  {
+    access_logger logger{{.sample_every_ = 2, .max_lines_per_second_ = 3},
+                         out};
+
+    access_log_entry e;
+    e.time_ = std::chrono::system_clock::now();
+    e.method_ = "GET";
+    e.set_target("/10/1/2.mvt");
+    e.status_ = 200;
+    e.bytes_ = 123;
+    e.total_ns_ = 2'500'000;
+    e.render_ns_ = 2'000'000;
+
+    logger.log(e);  // logged
+    logger.log(e);  // not sampled
+
+    e.status_ = 503;
+    logger.log(e);  // errors are always sampled
+
+    e.status_ = 200;
+    logger.log(e);  // not sampled
+    logger.log(e);  // logged
+    logger.log(e);  // not sampled
+    logger.log(e);  // rate limit exceeded
+
+    EXPECT_EQ(4, logger.dropped());
+  }
+
+  auto const log = out.str();
+  EXPECT_NE(std::string::npos,
+            log.find("access method=GET target=/10/1/2.mvt status=200 "
+                     "bytes=123 total_ms=2.500 render_ms=2.000\n"));
+  EXPECT_NE(std::string::npos, log.find("status=503"));
+  EXPECT_NE(std::string::npos, log.find("access log: 4 lines dropped\n"));
+  EXPECT_EQ(4, std::count(begin(log), end(log), '\n'));
+}
+
+TEST(access_log, truncate_target) {
+  access_log_entry e;
+  e.set_target(std::string(1000, 'x'));
+  EXPECT_EQ(e.target_.size(), e.target().size());
+}
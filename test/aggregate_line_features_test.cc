@@ -1,7 +1,10 @@
 #include "gtest/gtest.h"
 
+#include "tiles/db/shared_metadata.h"
 #include "tiles/feature/aggregate_line_features.h"
+#include "tiles/feature/deserialize.h"
 #include "tiles/feature/feature.h"
+#include "tiles/feature/serialize.h"
 
 TEST(aggregate_line_features, to_from) {
   tiles::feature f1;
@@ -112,3 +115,96 @@ TEST(aggregate_line_features, to_from_to_from) {
   EXPECT_TRUE(geo.front()[2] == tiles::fixed_xy(12, 12));
   EXPECT_TRUE(geo.front()[3] == tiles::fixed_xy(13, 13));
 }
+
+TEST(aggregate_line_features, metadata_encodings) {
+  tiles::shared_metadata_coder const coder{{{"highway", "primary"}}};
+
+  tiles::feature tagged;
+  tagged.meta_ = {{"highway", "primary"}, {"name", "A"}};
+
+  auto const encode = [&](bool const fast) {
+    std::string buf;
+    protozero::pbf_builder<tiles::tags::feature> pb{buf};
+    tiles::serialize_metadata(pb, tagged, coder, fast);
+    return buf;
+  };
+  auto const optimal = encode(false);  // shared id + uncoded pair
+  auto const quick = encode(true);  // all uncoded
+  ASSERT_NE(optimal, quick);
+
+  tiles::feature f1;  // eager
+  f1.id_ = 1;
+  f1.meta_ = tagged.meta_;
+  f1.geometry_ = tiles::fixed_polyline{{{10, 10}, {11, 11}}};
+
+  tiles::feature f2;
+  f2.id_ = 2;
+  f2.packed_meta_ = {optimal, &coder};
+  f2.geometry_ = tiles::fixed_polyline{{{11, 11}, {12, 12}}};
+
+  tiles::feature f3;
+  f3.id_ = 3;
+  f3.packed_meta_ = {quick, &coder};
+  f3.geometry_ = tiles::fixed_polyline{{{12, 12}, {13, 13}}};
+
+  tiles::feature f4;  // other tags
+  f4.id_ = 4;
+  f4.meta_ = {{"highway", "secondary"}};
+  f4.geometry_ = tiles::fixed_polyline{{{13, 13}, {14, 14}}};
+
+  auto result = tiles::aggregate_line_features({f4, f3, f2, f1}, 99);
+  ASSERT_EQ(2, result.size());
+
+  EXPECT_EQ(1, result[0].id_);
+  auto const geo = mpark::get<tiles::fixed_polyline>(result[0].geometry_);
+  ASSERT_EQ(1, geo.size());
+  EXPECT_EQ(4, geo.front().size());
+
+  std::vector<tiles::metadata> meta;
+  tiles::for_each_metadata(result[0], [&](auto const key, auto const value) {
+    meta.emplace_back(std::string{key}, std::string{value});
+  });
+  EXPECT_EQ(tagged.meta_, meta);
+
+  EXPECT_EQ(4, result[1].id_);
+}
+
+TEST(aggregate_line_features, metadata_order) {
+  tiles::shared_metadata_coder const coder{{{"highway", "primary"}}};
+
+  auto const make_feature = [](uint64_t const id,
+                               std::vector<tiles::metadata> meta,
+                               tiles::fixed_coord_t const x) {
+    tiles::feature f;
+    f.id_ = id;
+    f.meta_ = std::move(meta);
+    f.geometry_ = tiles::fixed_polyline{{{x, x}, {x + 1, x + 1}}};
+    return f;
+  };
+
+  // groups ordered like the eagerly decoded meta_ vectors (stored order)
+  std::vector<tiles::feature> features{
+      make_feature(1, {{"name", "A"}, {"highway", "primary"}}, 10),
+      make_feature(2, {{"highway", "primary"}, {"name", "B"}}, 20),
+      make_feature(3, {{"highway", "primary"}}, 30),
+      make_feature(4, {}, 40),
+      make_feature(5, {{"name", "A"}}, 50),
+      make_feature(6, {{"highway", "primary"}, {"name", "B"}}, 60)};
+
+  std::string optimal;  // packed: shared id + uncoded pair, same order
+  protozero::pbf_builder<tiles::tags::feature> pb{optimal};
+  tiles::serialize_metadata(pb, features[1], coder, false);
+  features[5].meta_.clear();
+  features[5].packed_meta_ = {optimal, &coder};
+
+  auto const result = tiles::aggregate_line_features(features, 99);
+  ASSERT_EQ(5, result.size());
+  EXPECT_EQ(4, result[0].id_);
+  EXPECT_EQ(3, result[1].id_);
+  EXPECT_EQ(2, result[2].id_);
+  EXPECT_EQ(5, result[3].id_);
+  EXPECT_EQ(1, result[4].id_);
+
+  auto const& geo = mpark::get<tiles::fixed_polyline>(result[2].geometry_);
+  EXPECT_EQ(2, geo.size());  // 2 and 6: not connected
+}
@@ -62,6 +62,28 @@ TEST(bq_tree_contains, l2_tree) {
   EXPECT_TRUE(false == tree.contains({42, 48, 8}));
 }
 
+TEST(bq_tree_intersects, l2_tree) {
+  EXPECT_TRUE(false == tiles::bq_tree{}.intersects({0, 0, 0}));
+  EXPECT_TRUE(true == tiles::make_bq_tree({{0, 0, 0}}).intersects({1, 2, 3}));
+
+  auto tree = tiles::make_bq_tree({{0, 1, 2}, {3, 3, 2}});
+
+  // self and children
+  EXPECT_TRUE(true == tree.intersects({0, 1, 2}));
+  EXPECT_TRUE(true == tree.intersects({1, 3, 3}));
+
+  // root and parents
+  EXPECT_TRUE(true == tree.intersects({0, 0, 0}));
+  EXPECT_TRUE(true == tree.intersects({0, 0, 1}));
+  EXPECT_TRUE(true == tree.intersects({1, 1, 1}));
+
+  // other
+  EXPECT_TRUE(false == tree.intersects({0, 1, 1}));
+  EXPECT_TRUE(false == tree.intersects({1, 0, 1}));
+  EXPECT_TRUE(false == tree.intersects({0, 0, 2}));
+  EXPECT_TRUE(false == tree.intersects({42, 48, 8}));
+}
+
 TEST(bq_tree_all_leafs, default_ctor) {
   auto const tree = tiles::bq_tree{};
   EXPECT_TRUE(true == tree.all_leafs({0, 0, 0}).empty());
@@ -0,0 +1,47 @@
+#include "gtest/gtest.h"
+
+#include "tiles/cancel_token.h"
+
+using tiles::cancel_token;
+
+TEST(cancel_token, cancel) {
+  cancel_token token;
+  EXPECT_FALSE(token.is_cancelled());
+  EXPECT_NO_THROW(token.throw_if_cancelled());
+
+  token.cancel();
+  EXPECT_TRUE(token.is_cancelled());
+  EXPECT_THROW(token.throw_if_cancelled(), tiles::render_cancelled);
+
+  EXPECT_FALSE(tiles::never_cancelled().is_cancelled());
+}
+
+TEST(cancel_token, interest) {
+  cancel_token token;
+  token.add_interest();
+  token.add_interest();
+
+  token.drop_interest();
+  EXPECT_FALSE(token.is_cancelled());
+
+  token.drop_interest();
+  EXPECT_TRUE(token.is_cancelled());
+
+  // everyone left, but someone new is interested again
+  token.add_interest();
+  EXPECT_FALSE(token.is_cancelled());
+
+  // explicit cancels stay
+  token.cancel();
+  token.add_interest();
+  EXPECT_TRUE(token.is_cancelled());
+}
+
+TEST(cancel_token, deadline) {
+  cancel_token token;
+  token.deadline_ = cancel_token::clock_t::now() + std::chrono::hours{1};
+  EXPECT_FALSE(token.is_cancelled());
+
+  token.deadline_ = cancel_token::clock_t::now() - std::chrono::seconds{1};
+  EXPECT_TRUE(token.is_cancelled());
+}
@@ -0,0 +1,68 @@
+#include "gtest/gtest.h"
+
+#include "zlib.h"
+
+#include "tiles/server/content_encoding.h"
+#include "tiles/util.h"
+
+using namespace tiles;
+
+TEST(content_encoding, negotiate) {
+  using ce = content_encoding;
+
+  EXPECT_EQ(ce::identity, negotiate_encoding(""));
+  EXPECT_EQ(ce::deflate, negotiate_encoding("deflate"));
+  EXPECT_EQ(ce::gzip, negotiate_encoding("gzip"));
+  EXPECT_EQ(ce::gzip, negotiate_encoding("x-gzip"));
+  EXPECT_EQ(ce::deflate, negotiate_encoding("gzip, deflate, br"));
+  EXPECT_EQ(ce::deflate, negotiate_encoding("*"));
+  EXPECT_EQ(ce::gzip, negotiate_encoding("GZIP;q=1.0, deflate;q=0.5"));
+  EXPECT_EQ(ce::gzip, negotiate_encoding("deflate;q=0, *;q=0.1"));
+  EXPECT_EQ(ce::identity, negotiate_encoding("br"));
+  EXPECT_EQ(ce::identity, negotiate_encoding("gzip;q=0"));
+  EXPECT_EQ(ce::identity, negotiate_encoding("identity, gzip;q=0.5"));
+
+  EXPECT_EQ(std::nullopt, negotiate_encoding("br, identity;q=0"));
+  EXPECT_EQ(std::nullopt, negotiate_encoding("*;q=0"));
+  EXPECT_EQ(std::nullopt, negotiate_encoding("gzip;q=0.000, *;q=0"));
+}
+
+TEST(content_encoding, negotiate_available) {
+  using ce = content_encoding;
+
+  auto const static_file = [](std::string_view accept_encoding) {
+    return negotiate_encoding(accept_encoding, {ce::gzip, ce::identity});
+  };
+  EXPECT_EQ(ce::identity, static_file(""));
+  EXPECT_EQ(ce::gzip, static_file("gzip, deflate, br"));
+  EXPECT_EQ(ce::gzip, static_file("*"));
+  EXPECT_EQ(ce::identity, static_file("deflate"));
+  EXPECT_EQ(std::nullopt, static_file("deflate, identity;q=0"));
+
+  EXPECT_EQ(std::nullopt, negotiate_encoding("", {ce::gzip}));
+}
+
+TEST(content_encoding, encode) {
+  std::string input;
+  for (auto i = 0; i < 1000; ++i) {
+    input += std::to_string(i);
+  }
+  auto const deflated = compress_deflate(input);
+
+  EXPECT_EQ(deflated, encode_tile(content_encoding::deflate, deflated));
+  EXPECT_EQ(input, encode_tile(content_encoding::identity, deflated));
+
+  auto const gzipped = encode_tile(content_encoding::gzip, deflated);
+  std::string out(input.size(), '\0');
+
+  z_stream strm{};
+  ASSERT_EQ(Z_OK, inflateInit2(&strm, 16 + MAX_WBITS));  // gzip only
+  strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(gzipped.data()));
+  strm.avail_in = static_cast<uInt>(gzipped.size());
+  strm.next_out = reinterpret_cast<Bytef*>(out.data());
+  strm.avail_out = static_cast<uInt>(out.size());
+  EXPECT_EQ(Z_STREAM_END, inflate(&strm, Z_FINISH));  // verifies crc + size
+  EXPECT_EQ(input.size(), strm.total_out);
+  inflateEnd(&strm);
+  EXPECT_EQ(input, out);
+}
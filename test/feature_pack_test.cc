@@ -1,9 +1,14 @@
 #include "gtest/gtest.h"
 
+#include "utl/to_vec.h"
+
 #include "tiles/bin_utils.h"
 #include "tiles/db/feature_pack.h"
+#include "tiles/db/shared_metadata.h"
+#include "tiles/feature/deserialize.h"
 #include "tiles/feature/feature.h"
 #include "tiles/feature/serialize.h"
+#include "tiles/fixed/algo/bounding_box.h"
 #include "tiles/fixed/convert.h"
 #include "tiles/fixed/fixed_geometry.h"
 
@@ -63,7 +68,7 @@ TEST(feature_pack, one) {
     EXPECT_TRUE(tiles::read_nth<uint32_t>(pack.data(), 0) ==
                 1U);  // feature count
     EXPECT_TRUE(tiles::read_nth<uint8_t>(pack.data(), 4) ==
-                1U);  // segment count
+                2U);  // segment count
 
     auto count = 0;
     tiles::unpack_features(pack, [&](auto const&) { ++count; });
@@ -74,3 +79,177 @@ TEST(feature_pack, one) {
     EXPECT_TRUE(count == 2);
   }
 }
+
+TEST(feature_pack, skip_index) {
+  tiles::fixed_polyline tuda{
+      {tiles::latlng_to_fixed({49.87805785566374, 8.654533624649048}),
+       tiles::latlng_to_fixed({49.87574857815668, 8.657859563827515})}};
+  tiles::fixed_point other{{tiles::latlng_to_fixed({50.1, 8.7})}};
+
+  auto const f1 = tiles::feature{1ULL, 1, {0U, 20U}, {}, tuda};
+  auto const f2 = tiles::feature{2ULL, 1, {0U, 12U}, {}, other};
+
+  auto const pack = tiles::pack_features(
+      {0, 0, 0}, {},
+      {tiles::pack_features(
+          {tiles::serialize_feature(f1), tiles::serialize_feature(f2)})});
+  ASSERT_TRUE(tiles::feature_pack_valid(pack));
+
+  auto const idx = tiles::feature_skip_index::find(pack);
+  ASSERT_TRUE(idx.has_value());
+  EXPECT_EQ(2U, idx->size());
+  EXPECT_EQ(idx->size(), idx->find_feature(0U));  // not a feature offset
+
+  auto const count = [&](std::optional<tiles::feature_skip_query> const& q) {
+    auto n = 0;
+    tiles::unpack_features(geo::tile{}, pack, geo::tile{}, q,
+                           [&](auto const&) { ++n; });
+    return n;
+  };
+
+  auto const tuda_box = tiles::bounding_box(tuda);
+  auto const query = [](uint32_t const z, tiles::fixed_box const& b) {
+    return tiles::feature_skip_query{z, b.min_corner().x(), b.min_corner().y(),
+                                     b.max_corner().x(), b.max_corner().y()};
+  };
+
+  EXPECT_EQ(2, count(std::nullopt));
+  EXPECT_EQ(2, count(tiles::feature_skip_query{10, -1, -1, 1LL << 40,
+                                               1LL << 40}));
+  EXPECT_EQ(1, count(tiles::feature_skip_query{15, 0, 0, 1LL << 40,
+                                               1LL << 40}));
+  EXPECT_EQ(1, count(query(10, tuda_box)));
+  EXPECT_EQ(0, count(tiles::feature_skip_query{10, 0, 0, 1, 1}));
+}
+
+TEST(feature_pack, columnar) {
+  tiles::fixed_polyline tuda{
+      {tiles::latlng_to_fixed({49.87805785566374, 8.654533624649048}),
+       tiles::latlng_to_fixed({49.87574857815668, 8.657859563827515})}};
+  tiles::fixed_point other{{tiles::latlng_to_fixed({50.1, 8.7})}};
+
+  tiles::shared_metadata_coder const coder{{{"highway", "primary"}}};
+
+  std::vector<tiles::feature> const features{
+      tiles::feature{1ULL,
+                     2,
+                     {0U, 20U},
+                     {{"highway", "primary"}, {"name", "Hochschulstr."}},
+                     tuda},
+      tiles::feature{2ULL, 1, {0U, 12U}, {}, other}};
+  auto const quick_pack = tiles::pack_features(
+      utl::to_vec(features, [](auto const& f) {
+        return tiles::serialize_feature(f);
+      }));
+
+  auto const v2 = tiles::pack_features({0, 0, 0}, coder, {quick_pack},
+                                       tiles::feature_pack_format::v2);
+  auto const v3 = tiles::pack_features({0, 0, 0}, coder, {quick_pack},
+                                       tiles::feature_pack_format::v3);
+  ASSERT_TRUE(tiles::feature_pack_valid(v3));
+  EXPECT_FALSE(tiles::feature_columns::find(v2).has_value());
+  ASSERT_TRUE(tiles::feature_columns::find(v3).has_value());
+  EXPECT_EQ(2U, tiles::feature_columns::find(v3)->size());
+
+  auto const unpack = [&](std::string const& pack, uint32_t const z) {
+    std::vector<tiles::feature> result;
+    auto const box = tiles::fixed_box{{0, 0}, {tiles::kFixedCoordMax,
+                                               tiles::kFixedCoordMax}};
+    tiles::unpack_features(geo::tile{}, pack, geo::tile{}, [&](auto const& f) {
+      if (auto feature = tiles::deserialize_feature(f, coder, box, z);
+          feature.has_value()) {
+        result.emplace_back(std::move(*feature));
+      }
+    });
+    std::sort(begin(result), end(result),
+              [](auto const& a, auto const& b) { return a.id_ < b.id_; });
+    return result;
+  };
+
+  for (auto const z : {0U, 5U, 14U}) {
+    auto const expected = unpack(v2, z);
+    auto const actual = unpack(v3, z);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (auto i = 0ULL; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i].id_, actual[i].id_);
+      EXPECT_EQ(expected[i].layer_, actual[i].layer_);
+      EXPECT_EQ(expected[i].zoom_levels_, actual[i].zoom_levels_);
+      EXPECT_EQ(expected[i].meta_, actual[i].meta_);
+      EXPECT_EQ(tiles::serialize(expected[i].geometry_),
+                tiles::serialize(actual[i].geometry_));
+    }
+  }
+  EXPECT_EQ(2U, unpack(v3, 5).size());
+  ASSERT_EQ(1U, unpack(v3, 14).size());
+  EXPECT_EQ(features[0].meta_, unpack(v3, 14).at(0).meta_);
+
+  // repacking reads v3 packs, too
+  auto const repacked = tiles::pack_features({0, 0, 0}, coder, {v3},
+                                             tiles::feature_pack_format::v2);
+  EXPECT_EQ(v2, repacked);
+}
+
+TEST(feature_pack, columnar_fallback) {
+  tiles::fixed_point pt{{tiles::latlng_to_fixed({50.1, 8.7})}};
+  tiles::shared_metadata_coder const coder{{}};
+
+  // max zoom level does not fit into the skip index column: stays v2
+  std::vector<tiles::feature> const features{
+      tiles::feature{1ULL, 0, {0U, 300U}, {}, pt}};
+  auto const quick_pack = tiles::pack_features(
+      utl::to_vec(features, [](auto const& f) {
+        return tiles::serialize_feature(f);
+      }));
+
+  auto const v2 = tiles::pack_features({0, 0, 0}, coder, {quick_pack},
+                                       tiles::feature_pack_format::v2);
+  auto const v3 = tiles::pack_features({0, 0, 0}, coder, {quick_pack},
+                                       tiles::feature_pack_format::v3);
+  EXPECT_FALSE(tiles::feature_columns::find(v3).has_value());
+  EXPECT_EQ(v2, v3);
+}
+
+TEST(feature_pack, lazy_metadata) {
+  tiles::fixed_polyline tuda{
+      {tiles::latlng_to_fixed({49.87805785566374, 8.654533624649048}),
+       tiles::latlng_to_fixed({49.87574857815668, 8.657859563827515})}};
+
+  tiles::shared_metadata_coder const coder{{{"highway", "primary"}}};
+  auto const f = tiles::feature{
+      1ULL, 2, {0U, 20U}, {{"highway", "primary"}, {"name", "Hochschulstr."}},
+      tuda};
+  auto const quick_pack = tiles::pack_features({tiles::serialize_feature(f)});
+
+  for (auto const format :
+       {tiles::feature_pack_format::v2, tiles::feature_pack_format::v3}) {
+    auto const pack =
+        tiles::pack_features({0, 0, 0}, coder, {quick_pack}, format);
+
+    auto count = 0;
+    tiles::unpack_features(geo::tile{}, pack, geo::tile{}, [&](auto const& s) {
+      auto const lazy = tiles::deserialize_feature(
+          s, coder, {{tiles::kInvalidBoxHint, tiles::kInvalidBoxHint},
+                     {tiles::kInvalidBoxHint, tiles::kInvalidBoxHint}},
+          tiles::kInvalidZoomLevel, tiles::metadata_decoding::lazy);
+      ASSERT_TRUE(lazy.has_value());
+      EXPECT_TRUE(lazy->meta_.empty());
+      EXPECT_FALSE(lazy->packed_meta_.fields_.empty());
+
+      std::vector<tiles::metadata> resolved;
+      tiles::for_each_metadata(*lazy, [&](auto const key, auto const value) {
+        resolved.emplace_back(std::string{key}, std::string{value});
+      });
+      EXPECT_EQ(f.meta_, resolved);
+
+      std::vector<uint64_t> shared_ids;
+      auto uncoded = 0;
+      tiles::for_each_metadata(
+          *lazy, [&](auto const id, auto const&) { shared_ids.push_back(id); },
+          [&](auto const, auto const) { ++uncoded; });
+      EXPECT_EQ(std::vector<uint64_t>{0U}, shared_ids);
+      EXPECT_EQ(1, uncoded);
+      ++count;
+    });
+    EXPECT_EQ(1, count);
+  }
+}
@@ -0,0 +1,38 @@
+#include "gtest/gtest.h"
+
+#include <random>
+#include <unordered_set>
+
+#include "tiles/flat_id_set.h"
+
+using tiles::flat_id_set;
+
+TEST(flat_id_set, insert) {
+  flat_id_set set;
+  EXPECT_TRUE(set.insert(0));
+  EXPECT_FALSE(set.insert(0));
+  EXPECT_TRUE(set.insert(flat_id_set::kEmpty));
+  EXPECT_FALSE(set.insert(flat_id_set::kEmpty));
+  EXPECT_EQ(2, set.size());
+
+  set.clear();
+  EXPECT_EQ(0, set.size());
+  EXPECT_TRUE(set.insert(flat_id_set::kEmpty));
+  EXPECT_TRUE(set.insert(0));
+}
+
+TEST(flat_id_set, random) {
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<uint64_t> dist{0, 5000};
+
+  flat_id_set set;
+  for (auto round = 0; round < 3; ++round) {
+    std::unordered_set<uint64_t> reference;
+    set.clear();
+    for (auto i = 0; i < 10000; ++i) {
+      auto const id = dist(gen);
+      EXPECT_EQ(reference.insert(id).second, set.insert(id));
+    }
+    EXPECT_EQ(reference.size(), set.size());
+  }
+}
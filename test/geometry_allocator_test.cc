@@ -0,0 +1,83 @@
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <memory_resource>
+
+#include "tiles/fixed/fixed_geometry.h"
+#include "tiles/fixed/geometry_allocator.h"
+
+using namespace tiles;
+
+TEST(geometry_allocator, default_resource) {
+  fixed_line line;
+  line.emplace_back(1, 2);
+  EXPECT_EQ(std::pmr::new_delete_resource(), line.get_allocator().resource_);
+}
+
+TEST(geometry_allocator, arena_scope) {
+  auto* const outside = current_geometry_resource();
+  {
+    geometry_arena_scope arena;
+    auto* const inside = current_geometry_resource();
+    EXPECT_NE(outside, inside);
+
+    fixed_polyline polyline;
+    polyline.emplace_back();
+    for (auto i = 0; i < 10000; ++i) {  // exceeds the first chunk
+      polyline.back().emplace_back(i, i);
+    }
+    EXPECT_EQ(inside, polyline.get_allocator().resource_);
+    EXPECT_EQ(inside, polyline.back().get_allocator().resource_);
+    EXPECT_EQ(fixed_xy(9999, 9999), polyline.back().back());
+
+    {
+      geometry_arena_scope nested;  // does not reset the outer arena
+      EXPECT_EQ(inside, current_geometry_resource());
+    }
+    EXPECT_EQ(inside, current_geometry_resource());
+    EXPECT_EQ(fixed_xy(0, 0), polyline.back().front());
+
+    // copies are allocated in the resource which is current at copy time
+    fixed_line copy_inside = polyline.back();
+    EXPECT_EQ(inside, copy_inside.get_allocator().resource_);
+  }
+  EXPECT_EQ(outside, current_geometry_resource());
+}
+
+TEST(geometry_allocator, arena_reuse) {
+  geometry_arena arena;
+  auto* const a = arena.allocate(64, 8);
+  auto* const b = arena.allocate(geometry_arena::kMinChunkSize, 8);
+  EXPECT_NE(a, b);  // second chunk
+  arena.reset();
+  EXPECT_EQ(a, arena.allocate(64, 8));  // first chunk is reused
+
+  auto* const aligned = arena.allocate(3, 64);
+  EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(aligned) % 64);
+}
+
+TEST(geometry_allocator, move_out_of_arena) {
+  fixed_line outer;  // lives longer than the arena scope
+  {
+    geometry_arena_scope arena;
+    fixed_line inner;
+    for (auto i = 0; i < 100; ++i) {
+      inner.emplace_back(i, i);
+    }
+    outer = std::move(inner);
+
+    // the elements were moved into the memory of the outer container
+    EXPECT_EQ(std::pmr::new_delete_resource(), outer.get_allocator().resource_);
+  }
+
+  // the arena has been reset (and reused) in between
+  {
+    geometry_arena_scope arena;
+    fixed_line other;
+    for (auto i = 0; i < 100; ++i) {
+      other.emplace_back(-1, -1);
+    }
+  }
+  ASSERT_EQ(100, outer.size());
+  EXPECT_EQ(fixed_xy(99, 99), outer.back());
+}
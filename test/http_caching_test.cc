@@ -0,0 +1,40 @@
+#include "gtest/gtest.h"
+
+#include "fmt/core.h"
+
+#include "tiles/server/http_caching.h"
+#include "tiles/util.h"
+
+using namespace tiles;
+
+TEST(http_caching, etag) {
+  auto const etag = make_tile_etag("abc", geo::tile{1, 2, 3});
+  EXPECT_EQ("\"abc-3-1-2\"", etag);
+
+  EXPECT_TRUE(etag_matches("\"abc-3-1-2\"", etag));
+  EXPECT_TRUE(etag_matches("W/\"abc-3-1-2\"", etag));
+  EXPECT_TRUE(etag_matches("\"x\", \"abc-3-1-2\" ", etag));
+  EXPECT_TRUE(etag_matches("*", etag));
+
+  EXPECT_FALSE(etag_matches("", etag));
+  EXPECT_FALSE(etag_matches("\"abc-3-1-3\"", etag));
+  EXPECT_FALSE(etag_matches("\"x\",\"y\"", etag));
+  EXPECT_FALSE(etag_matches("\"xyz-3-1-2\"", etag));
+
+  auto const gzip_etag = make_tile_etag("abc", geo::tile{1, 2, 3}, "gzip");
+  EXPECT_EQ("\"abc-3-1-2-gzip\"", gzip_etag);
+  EXPECT_FALSE(etag_matches(etag, gzip_etag));
+
+  // other compressor settings: other bytes
+  auto const z6_etag =
+      make_tile_etag("abc", geo::tile{1, 2, 3}, "", make_compressor_tag(6));
+  auto const z9_etag =
+      make_tile_etag("abc", geo::tile{1, 2, 3}, "", make_compressor_tag(9));
+  EXPECT_EQ(fmt::format("\"abc-3-1-2-{}6\"", compression_backend()),
+            z6_etag);
+  EXPECT_FALSE(etag_matches(z6_etag, z9_etag));
+  EXPECT_FALSE(etag_matches(z6_etag, etag));
+  EXPECT_EQ(fmt::format("\"abc-3-1-2-gzip-{}9\"", compression_backend()),
+            make_tile_etag("abc", geo::tile{1, 2, 3}, "gzip",
+                           make_compressor_tag(9)));
+}
@@ -0,0 +1,69 @@
+#include "gtest/gtest.h"
+
+#include <filesystem>
+#include <map>
+
+#include "tiles/db/migrate_feature_keys.h"
+#include "tiles/db/tile_database.h"
+
+using namespace tiles;
+
+struct migrate_feature_keys_test : public ::testing::Test {
+  migrate_feature_keys_test()
+      : dir_{std::filesystem::temp_directory_path() /
+             "tiles_migrate_feature_keys_test"} {
+    std::filesystem::remove_all(dir_);
+    std::filesystem::create_directories(dir_);
+  }
+
+  ~migrate_feature_keys_test() override { std::filesystem::remove_all(dir_); }
+
+  migrate_feature_keys_test(migrate_feature_keys_test const&) = delete;
+  migrate_feature_keys_test(migrate_feature_keys_test&&) = delete;
+  migrate_feature_keys_test& operator=(migrate_feature_keys_test const&) =
+      delete;
+  migrate_feature_keys_test& operator=(migrate_feature_keys_test&&) = delete;
+
+  std::filesystem::path dir_;
+};
+
+TEST_F(migrate_feature_keys_test, batches) {
+  auto const fname = (dir_ / "tiles.mdb").string();
+  auto env = make_tile_database(fname.c_str(), 1024 * 1024);
+  tile_db_handle handle{env};
+  ASSERT_EQ(tile_key_layout::row_major, handle.feature_key_layout_);
+
+  auto const entries = std::map<std::pair<uint32_t, uint32_t>, std::string>{
+      {{0, 0}, "a"}, {{1, 0}, "b"}, {{0, 1}, "c"},
+      {{1, 1}, "d"}, {{7, 3}, "e"}};
+  {
+    auto txn = handle.make_txn();
+    auto features_dbi = handle.features_dbi(txn);
+    for (auto const& [xy, value] : entries) {
+      txn.put(features_dbi,
+              tile_to_key(tile_key_layout::row_major,
+                          geo::tile{xy.first, xy.second, 10}),
+              value);
+    }
+    txn.commit();
+  }
+
+  migrate_feature_keys(handle, tile_key_layout::morton, 2);
+  EXPECT_EQ(tile_key_layout::morton, handle.feature_key_layout_);
+
+  auto txn = handle.make_txn();
+  auto features_dbi = handle.features_dbi(txn);
+  auto meta_dbi = handle.meta_dbi(txn);
+  EXPECT_EQ(tile_key_layout::morton, handle.read_feature_key_layout(txn));
+  EXPECT_FALSE(txn.get(meta_dbi, kMetaKeyFeatureKeyMigration).has_value());
+
+  auto migrated = std::map<std::pair<uint32_t, uint32_t>, std::string>{};
+  auto c = lmdb::cursor{txn, features_dbi};
+  for (auto el = c.get<tile_key_t>(lmdb::cursor_op::FIRST); el;
+       el = c.get<tile_key_t>(lmdb::cursor_op::NEXT)) {
+    auto const tile = key_to_tile(tile_key_layout::morton, el->first);
+    EXPECT_EQ(10, tile.z_);
+    migrated.emplace(std::pair{tile.x_, tile.y_}, std::string{el->second});
+  }
+  EXPECT_EQ(entries, migrated);
+}
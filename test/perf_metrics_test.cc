@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+
+#include <string>
+#include <thread>
+
+#include "tiles/server/perf_metrics.h"
+
+using namespace tiles;
+
+TEST(perf_metrics, histogram) {
+  perf_histogram h;
+  h.record(0);
+  h.record(1);
+  h.record(5);
+  h.record(7);
+  h.record(8);
+
+  perf_histogram_snapshot s;
+  s.merge(h);
+  EXPECT_EQ(1, s.buckets_[0]);
+  EXPECT_EQ(1, s.buckets_[1]);
+  EXPECT_EQ(2, s.buckets_[3]);
+  EXPECT_EQ(1, s.buckets_[4]);
+  EXPECT_EQ(5, s.count());
+  EXPECT_EQ(21, s.sum_);
+
+  s.merge(s);
+  EXPECT_EQ(10, s.count());
+  EXPECT_EQ(42, s.sum_);
+}
+
+TEST(perf_metrics, merge_threads) {
+  perf_metrics metrics;
+
+  auto const record = [&] {
+    metrics_perf_counter pc{metrics};
+    for (auto i = 0; i < 100; ++i) {
+      pc.append<perf_task::RESULT_SIZE>(1000);
+      start<perf_task::GET_TILE_TOTAL>(pc);
+      stop<perf_task::GET_TILE_TOTAL>(pc);
+    }
+  };
+
+  std::thread t1{record}, t2{record};
+  t1.join();
+  t2.join();
+  record();
+  EXPECT_EQ(3, metrics.threads_.size());
+
+  perf_counter pc;
+  pc.append<perf_task::RESULT_SIZE>(1000);
+  metrics.add(pc);  // main thread: no new histograms
+  EXPECT_EQ(3, metrics.threads_.size());
+
+  auto const snapshot = metrics.snapshot();
+  EXPECT_EQ(301, snapshot[perf_task::RESULT_SIZE].count());
+  EXPECT_EQ(301000, snapshot[perf_task::RESULT_SIZE].sum_);
+  EXPECT_EQ(301, snapshot[perf_task::RESULT_SIZE].buckets_[10]);
+  EXPECT_EQ(300, snapshot[perf_task::GET_TILE_TOTAL].count());
+  EXPECT_EQ(0, snapshot[perf_task::GET_TILE_FETCH].count());
+
+  std::string buf;
+  append_prometheus_metrics(buf, snapshot);
+  EXPECT_NE(std::string::npos,
+            buf.find("# TYPE tiles_result_size_bytes histogram\n"));
+  EXPECT_NE(std::string::npos,
+            buf.find("tiles_result_size_bytes_bucket{le=\"511\"} 0\n"));
+  EXPECT_NE(std::string::npos,
+            buf.find("tiles_result_size_bytes_bucket{le=\"1023\"} 301\n"));
+  EXPECT_NE(std::string::npos,
+            buf.find("tiles_result_size_bytes_bucket{le=\"+Inf\"} 301\n"));
+  EXPECT_NE(std::string::npos,
+            buf.find("tiles_result_size_bytes_sum 301000\n"));
+  EXPECT_NE(std::string::npos,
+            buf.find("tiles_get_tile_total_seconds_count 300\n"));
+}
+
+TEST(perf_metrics, alternate_instances) {
+  perf_metrics a, b;
+  for (auto i = 0; i < 10; ++i) {
+    metrics_perf_counter{a}.append<perf_task::RESULT_SIZE>(1);
+    metrics_perf_counter{b}.append<perf_task::RESULT_SIZE>(2);
+  }
+
+  // one set of histograms per thread and instance, no matter how often
+  EXPECT_EQ(1, a.threads_.size());
+  EXPECT_EQ(1, b.threads_.size());
+  EXPECT_EQ(10, a.snapshot()[perf_task::RESULT_SIZE].sum_);
+  EXPECT_EQ(20, b.snapshot()[perf_task::RESULT_SIZE].sum_);
+}
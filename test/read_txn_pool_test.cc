@@ -0,0 +1,79 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <filesystem>
+#include <thread>
+
+#include "tiles/db/read_txn_pool.h"
+#include "tiles/db/tile_database.h"
+
+using namespace tiles;
+
+struct read_txn_pool_test : public ::testing::Test {
+  read_txn_pool_test()
+      : dir_{std::filesystem::temp_directory_path() /
+             "tiles_read_txn_pool_test"} {
+    std::filesystem::remove_all(dir_);
+    std::filesystem::create_directories(dir_);
+  }
+
+  ~read_txn_pool_test() override { std::filesystem::remove_all(dir_); }
+
+  read_txn_pool_test(read_txn_pool_test const&) = delete;
+  read_txn_pool_test(read_txn_pool_test&&) = delete;
+  read_txn_pool_test& operator=(read_txn_pool_test const&) = delete;
+  read_txn_pool_test& operator=(read_txn_pool_test&&) = delete;
+
+  std::filesystem::path dir_;
+};
+
+TEST_F(read_txn_pool_test, reuse) {
+  auto const fname = (dir_ / "tiles.mdb").string();
+  auto env = make_tile_database(
+      fname.c_str(), 1024 * 1024,
+      lmdb::env_open_flags::NOSUBDIR | lmdb::env_open_flags::NOTLS, 8);
+  tile_db_handle handle{env};
+  read_txn_pool pool{handle, 2};
+
+  auto txn = pool.acquire();
+  auto const* raw = txn.get();
+  EXPECT_EQ(1, pool.in_use());
+
+  txn.reset();
+  EXPECT_EQ(0, pool.in_use());
+
+  txn = pool.acquire();
+  EXPECT_EQ(raw, txn.get());  // renewed, not a new one
+}
+
+TEST_F(read_txn_pool_test, cap) {
+  auto const fname = (dir_ / "tiles.mdb").string();
+  auto env = make_tile_database(
+      fname.c_str(), 1024 * 1024,
+      lmdb::env_open_flags::NOSUBDIR | lmdb::env_open_flags::NOTLS, 8);
+  tile_db_handle handle{env};
+  read_txn_pool pool{handle, 2};
+
+  auto a = pool.try_acquire(1);
+  ASSERT_NE(nullptr, a);
+  EXPECT_EQ(nullptr, pool.try_acquire(1));  // the last one is kept free
+
+  auto b = pool.try_acquire();
+  ASSERT_NE(nullptr, b);
+  EXPECT_EQ(nullptr, pool.try_acquire());
+  EXPECT_EQ(2, pool.in_use());
+
+  // blocks until one is back
+  std::atomic_bool acquired{false};
+  auto t = std::thread{[&] {
+    auto const c = pool.acquire();
+    acquired = true;
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  EXPECT_FALSE(acquired);
+
+  a.reset();
+  t.join();
+  EXPECT_TRUE(acquired);
+  EXPECT_EQ(1, pool.in_use());
+}
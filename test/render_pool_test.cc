@@ -0,0 +1,60 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <future>
+
+#include "tiles/server/render_pool.h"
+
+using tiles::render_pool;
+
+TEST(render_pool, executes) {
+  std::atomic_size_t executed{0};
+  {
+    render_pool pool{2, 100};
+    auto const deadline = render_pool::clock_t::now() + std::chrono::hours{1};
+    for (auto i = 0; i < 10; ++i) {
+      EXPECT_TRUE(pool.submit(deadline, [&](bool expired) {
+        EXPECT_FALSE(expired);
+        ++executed;
+      }));
+    }
+
+    while (executed != 10) {
+      std::this_thread::yield();
+    }
+  }
+  EXPECT_EQ(10, executed);
+}
+
+TEST(render_pool, back_pressure_and_deadline) {
+  std::promise<void> unblock;
+  auto blocked = unblock.get_future().share();
+
+  std::atomic_size_t started{0}, expired{0};
+  {
+    render_pool pool{1, 2};
+    auto const later = render_pool::clock_t::now() + std::chrono::hours{1};
+    auto const past = render_pool::clock_t::now() - std::chrono::seconds{1};
+
+    // occupy the only worker
+    ASSERT_TRUE(pool.submit(later, [&](bool) {
+      ++started;
+      blocked.wait();
+    }));
+    while (started != 1) {
+      std::this_thread::yield();
+    }
+
+    auto const count_expired = [&](bool e) { expired += e ? 1 : 0; };
+    EXPECT_TRUE(pool.submit(past, count_expired));
+    EXPECT_TRUE(pool.submit(past, count_expired));
+    EXPECT_FALSE(pool.submit(past, count_expired));  // queue full
+    EXPECT_EQ(2, pool.queue_size());
+
+    unblock.set_value();
+    while (expired != 2) {
+      std::this_thread::yield();
+    }
+  }
+  EXPECT_EQ(2, expired);
+}
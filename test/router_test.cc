@@ -0,0 +1,68 @@
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include "tiles/parse_tile_url.h"
+#include "tiles/server/router.h"
+
+using namespace tiles;
+
+TEST(router, parse_tile_url) {
+  EXPECT_EQ((geo::tile{1, 2, 3}), parse_tile_url("/3/1/2.mvt"));
+  EXPECT_EQ((geo::tile{8585, 5565, 14}),
+            parse_tile_url("/tiles/14/8585/5565.mvt"));
+
+  EXPECT_EQ(std::nullopt, parse_tile_url("/3/1/2.png"));
+  EXPECT_EQ(std::nullopt, parse_tile_url("/1/2.mvt"));
+  EXPECT_EQ(std::nullopt, parse_tile_url("/3/1/.mvt"));
+  EXPECT_EQ(std::nullopt, parse_tile_url("/3/a/2.mvt"));
+  EXPECT_EQ(std::nullopt, parse_tile_url("/3/-1/2.mvt"));
+  EXPECT_EQ(std::nullopt, parse_tile_url("/3/1/99999999999.mvt"));
+}
+
+TEST(router, route_request) {
+  url_buffer_t buf;
+
+  auto const tile = route_request("/10/537/347.mvt?v=1", buf);
+  EXPECT_EQ(endpoint::tile, tile.endpoint_);
+  EXPECT_EQ((geo::tile{537, 347, 10}), tile.tile_);
+
+  EXPECT_EQ(endpoint::metrics, route_request("/metrics", buf).endpoint_);
+
+  auto const batch = route_request("/batch/3/10/537/347", buf);
+  EXPECT_EQ(endpoint::batch, batch.endpoint_);
+  EXPECT_EQ((geo::tile{537, 347, 10}), batch.tile_);
+  EXPECT_EQ(3, batch.depth_);
+  EXPECT_EQ(endpoint::bad_request,
+            route_request("/batch/3/10/537", buf).endpoint_);
+  EXPECT_EQ(endpoint::bad_request,
+            route_request("/batch/3/10/537/347/1", buf).endpoint_);
+  EXPECT_EQ(endpoint::bad_request,
+            route_request("/batch/3/10//347", buf).endpoint_);
+
+  auto const glyphs =
+      route_request("/glyphs/Noto%20Sans%20Display+Bold/0-255.pbf", buf);
+  EXPECT_EQ(endpoint::glyphs, glyphs.endpoint_);
+  EXPECT_EQ("Noto Sans Display Bold/0-255.pbf", glyphs.name_);
+
+  auto const index = route_request("/", buf);
+  EXPECT_EQ(endpoint::file, index.endpoint_);
+  EXPECT_EQ("index.html", index.name_);
+
+  auto const file = route_request("/mapbox-gl.js?v=2", buf);
+  EXPECT_EQ(endpoint::file, file.endpoint_);
+  EXPECT_EQ("mapbox-gl.js", file.name_);
+
+  // malformed tile urls are just (missing) files
+  auto const not_a_tile = route_request("/10/x/347.mvt", buf);
+  EXPECT_EQ(endpoint::file, not_a_tile.endpoint_);
+  EXPECT_EQ("10/x/347.mvt", not_a_tile.name_);
+
+  EXPECT_EQ(endpoint::bad_request, route_request("", buf).endpoint_);
+  EXPECT_EQ(endpoint::bad_request, route_request("*", buf).endpoint_);
+  EXPECT_EQ(endpoint::bad_request, route_request("/a%2", buf).endpoint_);
+  EXPECT_EQ(endpoint::bad_request, route_request("/a%zz", buf).endpoint_);
+
+  auto const long_url = "/" + std::string(kMaxUrlLength, 'x');
+  EXPECT_EQ(endpoint::bad_request, route_request(long_url, buf).endpoint_);
+}
@@ -0,0 +1,76 @@
+#include "gtest/gtest.h"
+
+#include "tiles/db/bq_tree.h"
+#include "tiles/get_tile.h"
+#include "tiles/perf_counter.h"
+
+namespace tiles {
+
+render_ctx make_seaside_ctx() {
+  render_ctx ctx;
+  ctx.seaside_tiles_ = make_bq_tree({geo::tile{8, 5, 4}});
+  ctx.layer_names_ = {"coastline"};
+  return ctx;
+}
+
+TEST(seaside_tile, blob_equals_render) {
+  auto ctx = make_seaside_ctx();
+  auto const no_packs = [](auto&&) {};
+
+  auto const render = [&](geo::tile const& tile) {
+    null_perf_counter pc;
+    return get_tile(ctx, tile, no_packs, pc);
+  };
+
+  auto const tiles =
+      std::vector<geo::tile>{{8, 5, 4}, {17, 11, 5}, {35, 22, 6}};
+
+  std::vector<std::optional<std::string>> rendered;
+  for (auto const& tile : tiles) {
+    rendered.emplace_back(render(tile));
+    ASSERT_TRUE(rendered.back().has_value());
+  }
+
+  prepare_seaside_tile_blobs(ctx);
+  ASSERT_EQ(kMaxZoomLevel + 1, ctx.seaside_tile_blobs_.size());
+
+  for (auto i = 0U; i < tiles.size(); ++i) {
+    EXPECT_EQ(*rendered[i], ctx.seaside_tile_blobs_.at(tiles[i].z_));
+    EXPECT_EQ(rendered[i], render(tiles[i]));
+  }
+}
+
+TEST(seaside_tile, ignore_fully_seaside) {
+  auto ctx = make_seaside_ctx();
+  ctx.ignore_fully_seaside_ = true;
+  prepare_seaside_tile_blobs(ctx);
+
+  null_perf_counter pc;
+  EXPECT_FALSE(get_tile(ctx, geo::tile{17, 11, 5}, [](auto&&) {}, pc));
+
+  // partially seaside: rendered as usual
+  EXPECT_TRUE(get_tile(ctx, geo::tile{4, 2, 3}, [](auto&&) {}, pc));
+}
+
+TEST(seaside_tile, without_index) {
+  auto ctx = make_seaside_ctx();
+  ctx.content_tiles_ = make_bq_tree({geo::tile{0, 0, 3}});
+  prepare_seaside_tile_blobs(ctx);
+
+  auto index_used = false;
+  auto const packs = [&](auto&&) { index_used = true; };
+
+  // fully seaside, no content: the blob, without touching the index
+  null_perf_counter pc;
+  EXPECT_EQ(ctx.seaside_tile_blobs_.at(5),
+            get_tile(ctx, geo::tile{17, 11, 5}, packs, pc));
+  EXPECT_FALSE(index_used);
+
+  // fully seaside with content: looked up
+  ctx.content_tiles_ = make_bq_tree({geo::tile{17, 11, 5}});
+  EXPECT_EQ(ctx.seaside_tile_blobs_.at(5),
+            get_tile(ctx, geo::tile{17, 11, 5}, packs, pc));
+  EXPECT_TRUE(index_used);
+}
+
+}  // namespace tiles
@@ -0,0 +1,29 @@
+#include "gtest/gtest.h"
+
+#include "tiles/shared_tag_cache.h"
+
+using tiles::shared_tag_cache;
+using tag = shared_tag_cache::tag;
+
+TEST(shared_tag_cache, get_or_create) {
+  shared_tag_cache cache;
+
+  auto created = 0;
+  auto const create = [&](uint32_t const k, uint32_t const v) {
+    return [&created, k, v] {
+      ++created;
+      return tag{k, v};
+    };
+  };
+
+  EXPECT_EQ((tag{0, 1}), cache.get_or_create(7, create(0, 1)));
+  EXPECT_EQ((tag{0, 1}), cache.get_or_create(7, create(2, 3)));
+  EXPECT_EQ(shared_tag_cache::kSkip,
+            cache.get_or_create(1000, create(shared_tag_cache::kSkip.key_,
+                                             shared_tag_cache::kSkip.value_)));
+  EXPECT_EQ(2, created);
+
+  cache.clear();
+  EXPECT_EQ((tag{2, 3}), cache.get_or_create(7, create(2, 3)));
+  EXPECT_EQ(3, created);
+}
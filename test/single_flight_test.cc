@@ -0,0 +1,78 @@
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <string>
+
+#include "tiles/cancel_token.h"
+#include "tiles/server/single_flight.h"
+
+TEST(single_flight, coalesce) {
+  tiles::single_flight<uint64_t, std::string> sf;
+
+  std::vector<std::string> results;
+  auto const cb = [&](std::string const& s) { results.push_back(s); };
+
+  EXPECT_TRUE(sf.join(1, cb));  // leader
+  EXPECT_FALSE(sf.join(1, cb));
+  EXPECT_FALSE(sf.join(1, cb));
+  EXPECT_TRUE(sf.join(2, cb));  // other key -> other leader
+  EXPECT_EQ(2, sf.size());
+
+  sf.finish(1, "one");
+  EXPECT_EQ((std::vector<std::string>{"one", "one", "one"}), results);
+  EXPECT_EQ(1, sf.size());
+
+  // done -> next join is a new leader
+  EXPECT_TRUE(sf.join(1, cb));
+
+  results.clear();
+  sf.finish(2, "two");
+  sf.finish(1, "uno");
+  EXPECT_EQ((std::vector<std::string>{"two", "uno"}), results);
+  EXPECT_EQ(0, sf.size());
+
+  EXPECT_ANY_THROW(sf.finish(3, "three"));
+}
+
+TEST(single_flight, shared_state) {
+  tiles::single_flight<uint64_t, std::string, int> sf;
+  auto const cb = [](std::string const&) {};
+
+  std::shared_ptr<int> s1, s2, s3;
+  EXPECT_TRUE(sf.join(1, cb, &s1));
+  EXPECT_FALSE(sf.join(1, cb, &s2));
+  EXPECT_TRUE(sf.join(2, cb, &s3));
+  EXPECT_EQ(s1, s2);
+  EXPECT_NE(s1, s3);
+
+  sf.finish(1, "one");
+  EXPECT_TRUE(sf.join(1, cb, &s2));  // new leader, new state
+  EXPECT_NE(s1, s2);
+}
+
+TEST(single_flight, all_leave_then_one_joins) {
+  tiles::single_flight<uint64_t, std::string, tiles::cancel_token> sf;
+
+  std::vector<std::string> results;
+  auto const cb = [&](std::string const& s) { results.push_back(s); };
+
+  std::shared_ptr<tiles::cancel_token> c1, c2, c3;
+  EXPECT_TRUE(sf.join(1, cb, &c1));
+  c1->add_interest();
+  EXPECT_FALSE(sf.join(1, cb, &c2));
+  c2->add_interest();
+
+  c1->drop_interest();
+  EXPECT_FALSE(c1->is_cancelled());
+  c2->drop_interest();
+  EXPECT_TRUE(c1->is_cancelled());  // nobody is waiting anymore
+
+  // still in flight: joins the same render, which must go on
+  EXPECT_FALSE(sf.join(1, cb, &c3));
+  c3->add_interest();
+  EXPECT_EQ(c1, c3);
+  EXPECT_FALSE(c3->is_cancelled());
+
+  sf.finish(1, "one");
+  EXPECT_EQ((std::vector<std::string>{"one", "one", "one"}), results);
+}
@@ -0,0 +1,114 @@
+#include "gtest/gtest.h"
+
+#include <filesystem>
+#include <fstream>
+
+#include "zlib.h"
+
+#include "tiles/server/static_resources.h"
+
+using namespace tiles;
+
+namespace {
+
+std::string gunzip(std::string const& in, size_t const size) {
+  std::string out(size, '\0');
+  z_stream strm{};
+  EXPECT_EQ(Z_OK, inflateInit2(&strm, 16 + MAX_WBITS));  // gzip only
+  strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+  strm.avail_in = static_cast<uInt>(in.size());
+  strm.next_out = reinterpret_cast<Bytef*>(out.data());
+  strm.avail_out = static_cast<uInt>(out.size());
+  EXPECT_EQ(Z_STREAM_END, inflate(&strm, Z_FINISH));
+  inflateEnd(&strm);
+  return out;
+}
+
+}  // namespace
+
+TEST(static_resources, content_type) {
+  EXPECT_EQ("text/html", guess_content_type("index.html"));
+  EXPECT_EQ("text/javascript", guess_content_type("mapbox-gl.js"));
+  EXPECT_EQ("application/json", guess_content_type("style.json"));
+  EXPECT_EQ("application/x-protobuf",
+            guess_content_type("Noto Sans Display Bold/0-255.pbf"));
+  EXPECT_EQ("application/octet-stream", guess_content_type("README"));
+
+  EXPECT_TRUE(is_compressible("text/css"));
+  EXPECT_FALSE(is_compressible("image/png"));
+}
+
+TEST(static_resources, make_static_resource) {
+  std::string content;
+  for (auto i = 0; i < 1000; ++i) {
+    content += "var x = " + std::to_string(i) + ";\n";
+  }
+
+  auto const a = make_static_resource("a.js", content);
+  EXPECT_EQ(content, a->identity_);
+  EXPECT_EQ("text/javascript", a->content_type_);
+  ASSERT_FALSE(a->gzip_.empty());
+  EXPECT_LT(a->gzip_.size(), content.size());
+  EXPECT_EQ(content, gunzip(a->gzip_, content.size()));
+  EXPECT_NE(a->etag_, a->gzip_etag_);
+
+  // static memory is not copied, the etag depends only on the content
+  auto const b = make_static_resource("b.js", std::string_view{content});
+  EXPECT_EQ(content.data(), b->identity_.data());
+  EXPECT_EQ(a->etag_, b->etag_);
+
+  auto const c = make_static_resource("c.js", content + " ");
+  EXPECT_NE(a->etag_, c->etag_);
+
+  // small or already compressed: no gzip variant
+  EXPECT_TRUE(make_static_resource("d.js", std::string{"x"})->gzip_.empty());
+  EXPECT_TRUE(make_static_resource("e.png", content)->gzip_.empty());
+}
+
+TEST(static_resources, table) {
+  auto const dir = std::filesystem::temp_directory_path() /
+                   "tiles_static_resources_test";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir / "font");
+  std::ofstream{dir / "index.html"} << "<html>from disk</html>";
+  std::ofstream{dir / "font" / "0-255.pbf"} << "glyphs";
+
+  static constexpr auto const kEmbeddedIndex =
+      std::string_view{"<html>embedded</html>"};
+  static constexpr auto const kEmbeddedCss = std::string_view{"body {}"};
+  auto fallback_calls = 0;
+  static_resources resources{
+      [&](std::string const& name) -> std::optional<std::string_view> {
+        ++fallback_calls;
+        if (name == "index.html") {
+          return kEmbeddedIndex;
+        } else if (name == "style.css") {
+          return kEmbeddedCss;
+        }
+        return std::nullopt;
+      }};
+  resources.add_directory(dir);
+  EXPECT_EQ(2, resources.size());
+
+  // files on disk take precedence over embedded resources
+  auto const* index = resources.find("index.html");
+  ASSERT_NE(nullptr, index);
+  EXPECT_EQ("<html>from disk</html>", index->identity_);
+
+  auto const* glyphs = resources.find("font/0-255.pbf");
+  ASSERT_NE(nullptr, glyphs);
+  EXPECT_EQ("glyphs", glyphs->identity_);
+  EXPECT_EQ(0, fallback_calls);
+
+  // embedded resources are looked up once
+  auto const* css = resources.find("style.css");
+  ASSERT_NE(nullptr, css);
+  EXPECT_EQ(kEmbeddedCss.data(), css->identity_.data());
+  EXPECT_EQ(css, resources.find("style.css"));
+  EXPECT_EQ(1, fallback_calls);
+
+  EXPECT_EQ(nullptr, resources.find("missing.js"));
+  EXPECT_EQ(2, fallback_calls);
+
+  std::filesystem::remove_all(dir);
+}
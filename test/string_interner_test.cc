@@ -0,0 +1,39 @@
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include "tiles/string_interner.h"
+
+using tiles::string_interner;
+
+TEST(string_interner, get_or_create) {
+  string_interner si;
+  EXPECT_EQ(0, si.get_or_create("a"));
+  EXPECT_EQ(1, si.get_or_create("b"));
+  EXPECT_EQ(2, si.get_or_create(""));
+  EXPECT_EQ(0, si.get_or_create("a"));
+  EXPECT_EQ(2, si.get_or_create(""));
+  EXPECT_EQ(3, si.size());
+
+  EXPECT_EQ("a", si.at(0));
+  EXPECT_EQ("b", si.at(1));
+  EXPECT_EQ("", si.at(2));
+
+  si.clear();
+  EXPECT_TRUE(si.empty());
+  EXPECT_EQ(0, si.get_or_create("b"));
+}
+
+TEST(string_interner, many) {
+  string_interner si;
+  for (auto round = 0; round < 2; ++round) {
+    si.clear();
+    for (auto i = 0; i < 1000; ++i) {
+      EXPECT_EQ(i, si.get_or_create(std::to_string(i)));
+    }
+    for (auto i = 0; i < 1000; ++i) {
+      EXPECT_EQ(i, si.get_or_create(std::to_string(i)));
+      EXPECT_EQ(std::to_string(i), si.at(i));
+    }
+  }
+}
@@ -0,0 +1,43 @@
+#include "gtest/gtest.h"
+
+#include "tiles/server/tile_batch.h"
+
+using namespace tiles;
+
+TEST(tile_batch, batch_tiles) {
+  EXPECT_EQ((std::vector<geo::tile>{{5, 7, 3}}),
+            batch_tiles(geo::tile{5, 7, 3}, 0));
+
+  EXPECT_EQ((std::vector<geo::tile>{
+                {10, 14, 4}, {11, 14, 4}, {10, 15, 4}, {11, 15, 4}}),
+            batch_tiles(geo::tile{5, 7, 3}, 1));
+
+  auto const block = batch_tiles(geo::tile{1, 2, 10}, kMaxBatchDepth);
+  ASSERT_EQ(64, block.size());
+  for (auto const& tile : block) {
+    EXPECT_EQ(13, tile.z_);
+    EXPECT_EQ((geo::tile{1, 2, 10}), tile.parent().parent().parent());
+  }
+
+  EXPECT_ANY_THROW(batch_tiles(geo::tile{0, 0, 0}, kMaxBatchDepth + 1));
+}
+
+TEST(tile_batch, frames) {
+  std::string buf;
+  append_tile_frame(buf, geo::tile{1, 2, 3}, "abc");
+  append_tile_frame(buf, geo::tile{4, 5, 6}, "");
+  append_tile_frame(buf, geo::tile{7, 8, 9}, std::string(1000, 'x'));
+  EXPECT_EQ(3 * 16 + 3 + 1000, buf.size());
+
+  auto const frames = parse_tile_frames(buf);
+  ASSERT_EQ(3, frames.size());
+  EXPECT_EQ((geo::tile{1, 2, 3}), frames[0].first);
+  EXPECT_EQ("abc", frames[0].second);
+  EXPECT_EQ((geo::tile{4, 5, 6}), frames[1].first);
+  EXPECT_TRUE(frames[1].second.empty());
+  EXPECT_EQ((geo::tile{7, 8, 9}), frames[2].first);
+  EXPECT_EQ(std::string(1000, 'x'), frames[2].second);
+
+  EXPECT_ANY_THROW(parse_tile_frames(std::string_view{buf}.substr(0, 10)));
+  EXPECT_ANY_THROW(parse_tile_frames(std::string_view{buf}.substr(0, 18)));
+}
@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+
+#include "tiles/server/tile_cache.h"
+
+namespace {
+
+tiles::tile_cache::value_t make_value(size_t size) {
+  return std::make_shared<std::string const>(size, 'x');
+}
+
+}  // namespace
+
+TEST(tile_cache, get_put) {
+  tiles::tile_cache cache{1024 * 1024, 4};
+
+  auto const key = tiles::tile_to_key(geo::tile{1, 2, 3});
+  EXPECT_EQ(nullptr, cache.get(key));
+
+  cache.put(key, make_value(42));
+  auto const value = cache.get(key);
+  ASSERT_NE(nullptr, value);
+  EXPECT_EQ(42, value->size());
+
+  // empty tiles are cached too
+  auto const empty_key = tiles::tile_to_key(geo::tile{2, 2, 3});
+  cache.put(empty_key, make_value(0));
+  ASSERT_NE(nullptr, cache.get(empty_key));
+  EXPECT_TRUE(cache.get(empty_key)->empty());
+
+  auto const stats = cache.get_stats();
+  EXPECT_EQ(3, stats.hits_);
+  EXPECT_EQ(1, stats.misses_);
+  EXPECT_EQ(2, stats.inserts_);
+  EXPECT_EQ(0, stats.evictions_);
+  EXPECT_EQ(2, stats.entries_);
+}
+
+TEST(tile_cache, replace) {
+  tiles::tile_cache cache{1024 * 1024, 1};
+
+  auto const key = tiles::tile_to_key(geo::tile{1, 2, 3});
+  cache.put(key, make_value(10));
+  cache.put(key, make_value(20));
+
+  ASSERT_NE(nullptr, cache.get(key));
+  EXPECT_EQ(20, cache.get(key)->size());
+
+  auto const stats = cache.get_stats();
+  EXPECT_EQ(1, stats.entries_);
+  EXPECT_EQ(20 + tiles::tile_cache::kEntryOverhead, stats.bytes_);
+}
+
+TEST(tile_cache, byte_bound) {
+  auto const entry_size = 1000 + tiles::tile_cache::kEntryOverhead;
+  tiles::tile_cache cache{10 * entry_size, 1};
+
+  for (auto x = 0U; x < 100U; ++x) {
+    cache.put(tiles::tile_to_key(geo::tile{x, 0, 10}), make_value(1000));
+    EXPECT_LE(cache.get_stats().bytes_, 10 * entry_size);
+  }
+
+  auto const stats = cache.get_stats();
+  EXPECT_EQ(10, stats.entries_);
+  EXPECT_EQ(90, stats.evictions_);
+
+  // too large to ever fit
+  cache.put(tiles::tile_to_key(geo::tile{0, 1, 10}), make_value(100 * 1000));
+  EXPECT_EQ(nullptr, cache.get(tiles::tile_to_key(geo::tile{0, 1, 10})));
+}
+
+TEST(tile_cache, second_chance) {
+  auto const entry_size = 1000 + tiles::tile_cache::kEntryOverhead;
+  tiles::tile_cache cache{4 * entry_size, 1};
+
+  auto const key = [](uint32_t x) {
+    return tiles::tile_to_key(geo::tile{x, 0, 10});
+  };
+
+  for (auto x = 0U; x < 4U; ++x) {
+    cache.put(key(x), make_value(1000));
+  }
+
+  // hot entry survives the next insert, the oldest cold one is evicted
+  ASSERT_NE(nullptr, cache.get(key(0)));
+  cache.put(key(4), make_value(1000));
+
+  EXPECT_NE(nullptr, cache.get(key(0)));
+  EXPECT_EQ(nullptr, cache.get(key(1)));
+  EXPECT_NE(nullptr, cache.get(key(4)));
+}
@@ -30,3 +30,56 @@ TEST(tile_index, tile_index) {
   EXPECT_EQ((geo::tile{0, 2097151, 0}),
             (tiles::key_to_tile(tiles::tile_to_key(geo::tile{0, 2097151, 0}))));
 }
+
+TEST(tile_index, morton) {
+  using tiles::tile_key_layout;
+
+  std::vector<tiles::tile_key_t> keys;
+  for (geo::tile_iterator it{0}; it->z_ != 6; ++it) {
+    for (auto n : {0UL, 1UL, 131071UL}) {
+      SCOPED_TRACE(*it);
+      SCOPED_TRACE(n);
+
+      auto const key = tiles::tile_to_key(tile_key_layout::morton, *it, n);
+
+      EXPECT_EQ(*it, tiles::key_to_tile(tile_key_layout::morton, key));
+      EXPECT_EQ(n, tiles::key_to_n(key));
+
+      keys.push_back(key);
+    }
+  }
+
+  auto const keys_size = keys.size();
+  utl::erase_duplicates(keys);
+  EXPECT_EQ(keys_size, keys.size());
+
+  for (auto const& t : {geo::tile{2097151, 0, 21}, geo::tile{0, 2097151, 21},
+                        geo::tile{2097151, 2097151, 31}}) {
+    EXPECT_EQ(t, tiles::key_to_tile(tile_key_layout::morton,
+                                    tiles::tile_to_key(
+                                        tile_key_layout::morton, t, 7)));
+  }
+}
+
+TEST(tile_index, morton_key_range) {
+  using tiles::tile_key_layout;
+
+  // exactly the descendants (on z = 5) are inside the range
+  for (auto const& query : {geo::tile{0, 0, 0}, geo::tile{1, 0, 1},
+                            geo::tile{2, 3, 2}, geo::tile{21, 9, 5},
+                            geo::tile{43, 19, 6}}) {
+    SCOPED_TRACE(query);
+    auto const [begin, end] = tiles::morton_key_range(query, 5);
+
+    auto const query_bounds = query.bounds_on_z(5);
+    for (geo::tile_iterator it{5}; it->z_ == 5; ++it) {
+      auto const inside =
+          it->x_ >= query_bounds.minx_ && it->x_ < query_bounds.maxx_ &&
+          it->y_ >= query_bounds.miny_ && it->y_ < query_bounds.maxy_;
+      for (auto n : {0UL, 131071UL}) {
+        auto const key = tiles::tile_to_key(tile_key_layout::morton, *it, n);
+        EXPECT_EQ(inside, key >= begin && key < end);
+      }
+    }
+  }
+}
@@ -0,0 +1,32 @@
+#include "gtest/gtest.h"
+
+#include "tiles/zoom_band.h"
+
+using namespace tiles;
+
+TEST(zoom_band, parse_and_get) {
+  auto const bands = parse_zoom_bands({"0-8:86400", "9:3600", "0-20:60"});
+  ASSERT_EQ(3, bands.size());
+
+  EXPECT_EQ(86400, get_zoom_band_value(bands, 0));
+  EXPECT_EQ(86400, get_zoom_band_value(bands, 8));
+  EXPECT_EQ(3600, get_zoom_band_value(bands, 9));
+  EXPECT_EQ(60, get_zoom_band_value(bands, 10));
+  EXPECT_EQ(std::nullopt, get_zoom_band_value(bands, 21));
+
+  EXPECT_EQ(-1, get_zoom_band_value(parse_zoom_bands({"3:-1"}), 3));
+
+  EXPECT_ANY_THROW(parse_zoom_bands({"0-8"}));
+  EXPECT_ANY_THROW(parse_zoom_bands({"8-0:60"}));
+  EXPECT_ANY_THROW(parse_zoom_bands({"a:60"}));
+  EXPECT_ANY_THROW(parse_zoom_bands({"1:"}));
+}
+
+TEST(zoom_band, value_range) {
+  EXPECT_EQ(9, get_zoom_band_value(parse_zoom_bands({"0-20:9"}, 0, 9), 3));
+  EXPECT_EQ(0, get_zoom_band_value(parse_zoom_bands({"0-20:0"}, 0, 9), 3));
+
+  EXPECT_ANY_THROW(parse_zoom_bands({"0-20:10"}, 0, 9));
+  EXPECT_ANY_THROW(parse_zoom_bands({"3:-1"}, 0, 9));
+  EXPECT_ANY_THROW(parse_zoom_bands({"0-8:6", "9:12"}, 0, 9));
+}